@@ -96,6 +96,464 @@ static const struct file_operations fops_wcn36xx_bmps = {
 	.write =       write_file_bool_bmps,
 };
 
+static ssize_t read_file_pmc_stats(struct file *file, char __user *user_buf,
+				   size_t count, loff_t *ppos)
+{
+	struct wcn36xx *wcn = file->private_data;
+	struct wcn36xx_vif *vif_priv = NULL;
+	struct ieee80211_vif *vif = NULL;
+	struct wcn36xx_pmc *pmc;
+	char buf[512];
+	size_t len = 0;
+
+	mutex_lock(&wcn->conf_mutex);
+	list_for_each_entry(vif_priv, &wcn->vif_list, list) {
+		vif = wcn36xx_priv_to_vif(vif_priv);
+		if (NL80211_IFTYPE_STATION != vif->type)
+			continue;
+
+		pmc = &vif_priv->pmc;
+		mutex_lock(&pmc->lock);
+		len += scnprintf(buf + len, sizeof(buf) - len,
+				 "%pM %s%s\n"
+				 "full power %llu ms bmps %llu ms\n"
+				 "enter %u exit %u fail %u uapsd %u acs 0x%x%s\n"
+				 "enter avg %llu us max %u us\n"
+				 "exit avg %llu us max %u us\n",
+				 vif->addr,
+				 vif_priv->pw_state == WCN36XX_BMPS ?
+				 "bmps" : "full power",
+				 pmc->allowed ? "" : " (ps off)",
+				 wcn36xx_pmc_time_in_state(pmc,
+							   WCN36XX_FULL_POWER),
+				 wcn36xx_pmc_time_in_state(pmc, WCN36XX_BMPS),
+				 pmc->enter, pmc->exit, pmc->fail, pmc->uapsd,
+				 vif_priv->uapsd_acs,
+				 vif_priv->uapsd_active ? " active" : "",
+				 pmc->enter ?
+				 div_u64(pmc->enter_lat_us, pmc->enter) : 0,
+				 pmc->enter_lat_max_us,
+				 pmc->exit ?
+				 div_u64(pmc->exit_lat_us, pmc->exit) : 0,
+				 pmc->exit_lat_max_us);
+		mutex_unlock(&pmc->lock);
+	}
+	mutex_unlock(&wcn->conf_mutex);
+
+	return simple_read_from_buffer(user_buf, count, ppos, buf, len);
+}
+
+static const struct file_operations fops_wcn36xx_pmc_stats = {
+	.open  =       simple_open,
+	.read  =       read_file_pmc_stats,
+};
+
+static ssize_t read_file_offload(struct file *file, char __user *user_buf,
+				 size_t count, loff_t *ppos)
+{
+	struct wcn36xx *wcn = file->private_data;
+	struct wcn36xx_vif *vif_priv = NULL;
+	struct wcn36xx_host_offload *offload;
+	char buf[512];
+	size_t len = 0;
+	int i;
+
+	mutex_lock(&wcn->conf_mutex);
+	list_for_each_entry(vif_priv, &wcn->vif_list, list) {
+		offload = &vif_priv->offload;
+		len += scnprintf(buf + len, sizeof(buf) - len,
+				 "%pM\narp %pI4 updates %u seen %u\n",
+				 wcn36xx_priv_to_vif(vif_priv)->addr,
+				 &offload->arp_addr, offload->arp_updates,
+				 offload->arp_seen);
+		len += scnprintf(buf + len, sizeof(buf) - len,
+				 "ns updates %u seen %u\n",
+				 offload->ns_updates, offload->ns_seen);
+		spin_lock_bh(&offload->lock);
+		for (i = 0; i < offload->ns_addr_cnt; i++)
+			len += scnprintf(buf + len, sizeof(buf) - len,
+					 "ns %pI6c\n", &offload->ns_addr[i]);
+		spin_unlock_bh(&offload->lock);
+	}
+	mutex_unlock(&wcn->conf_mutex);
+
+	return simple_read_from_buffer(user_buf, count, ppos, buf, len);
+}
+
+static const struct file_operations fops_wcn36xx_offload = {
+	.open  =       simple_open,
+	.read  =       read_file_offload,
+};
+
+static ssize_t read_file_packet_filter(struct file *file,
+				       char __user *user_buf,
+				       size_t count, loff_t *ppos)
+{
+	struct wcn36xx *wcn = file->private_data;
+	struct wcn36xx_hal_rcv_pkt_filter_params *params;
+	struct wcn36xx_pkt_filter *filter;
+	struct wcn36xx_vif *vif_priv = NULL;
+	size_t len = 0, size = 2048;
+	ssize_t ret;
+	char *buf;
+	int i, j;
+
+	buf = kzalloc(size, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	mutex_lock(&wcn->conf_mutex);
+	mutex_lock(&wcn->pkt_filter_lock);
+	list_for_each_entry(vif_priv, &wcn->vif_list, list)
+		if (vif_priv->sta_assoc)
+			wcn36xx_smd_packet_filter_match_count(wcn,
+				wcn36xx_priv_to_vif(vif_priv));
+
+	for (i = 0; i < WCN36XX_HAL_MAX_NUM_FILTERS; i++) {
+		filter = &wcn->pkt_filters[i];
+		if (!filter->used)
+			continue;
+
+		len += scnprintf(buf + len, size - len, "%d %d", i,
+				 filter->type);
+		for (j = 0; j < filter->params_count; j++) {
+			params = &filter->params[j];
+			len += scnprintf(buf + len, size - len,
+					 " %d,%d,%d,%*phN,%*phN",
+					 params->protocol_layer,
+					 params->cmp_flag, params->data_offset,
+					 params->data_length,
+					 params->compare_data,
+					 params->data_length,
+					 params->data_mask);
+		}
+		len += scnprintf(buf + len, size - len, " matched %u\n",
+				 filter->match_cnt);
+	}
+	mutex_unlock(&wcn->pkt_filter_lock);
+	mutex_unlock(&wcn->conf_mutex);
+
+	ret = simple_read_from_buffer(user_buf, count, ppos, buf, len);
+	kfree(buf);
+	return ret;
+}
+
+/* <proto>,<cmp>,<offset>,<hex data>[,<hex mask>] */
+static int wcn36xx_parse_filter_params(char *str,
+			struct wcn36xx_hal_rcv_pkt_filter_params *params)
+{
+	char *proto, *cmp, *offset, *data, *mask;
+	size_t data_len;
+	u8 val;
+
+	proto = strsep(&str, ",");
+	cmp = strsep(&str, ",");
+	offset = strsep(&str, ",");
+	data = strsep(&str, ",");
+	mask = strsep(&str, ",");
+	if (!data)
+		return -EINVAL;
+
+	data_len = strlen(data) / 2;
+	if (!data_len || data_len > WCN36XX_HAL_PROTOCOL_DATA_LEN ||
+	    hex2bin(params->compare_data, data, data_len))
+		return -EINVAL;
+	if (mask && (strlen(mask) / 2 != data_len ||
+		     hex2bin(params->data_mask, mask, data_len)))
+		return -EINVAL;
+	params->data_length = data_len;
+
+	if (kstrtou8(proto, 0, &val) || !val ||
+	    val >= HAL_FILTER_PROTO_TYPE_MAX)
+		return -EINVAL;
+	params->protocol_layer = val;
+	if (kstrtou8(cmp, 0, &val) || !val || val >= HAL_FILTER_CMP_TYPE_MAX)
+		return -EINVAL;
+	params->cmp_flag = val;
+	if (kstrtou8(offset, 0, &params->data_offset))
+		return -EINVAL;
+
+	return 0;
+}
+
+/*
+ * "<id> <type> <params> [<params> ...]" sets a filter, "clear <id>"
+ * removes one and a bare "clear" removes them all.
+ */
+static ssize_t write_file_packet_filter(struct file *file,
+					const char __user *user_buf,
+					size_t count, loff_t *ppos)
+{
+	struct wcn36xx *wcn = file->private_data;
+	struct wcn36xx_pkt_filter filter, *slot;
+	struct wcn36xx_vif *vif_priv = NULL;
+	char buf[512], *tmp, *tok;
+	int first = 0, last = WCN36XX_HAL_MAX_NUM_FILTERS - 1;
+	bool clear = false;
+	u8 id;
+	int i;
+
+	memset(buf, 0, sizeof(buf));
+	memset(&filter, 0, sizeof(filter));
+
+	if (copy_from_user(buf, user_buf, min(count, sizeof(buf) - 1)))
+		return -EFAULT;
+
+	tmp = strim(buf);
+	tok = strsep(&tmp, " ");
+	if (!strcmp(tok, "clear")) {
+		clear = true;
+		tok = strsep(&tmp, " ");
+		if (tok) {
+			if (kstrtou8(tok, 0, &id) ||
+			    id >= WCN36XX_HAL_MAX_NUM_FILTERS)
+				return -EINVAL;
+			first = last = id;
+		}
+	} else {
+		if (kstrtou8(tok, 0, &id) || id >= WCN36XX_HAL_MAX_NUM_FILTERS)
+			return -EINVAL;
+		tok = strsep(&tmp, " ");
+		if (!tok || kstrtou8(tok, 0, &filter.type) || !filter.type ||
+		    filter.type >= HAL_RCV_FILTER_TYPE_MAX_ENUM_SIZE)
+			return -EINVAL;
+		while ((tok = strsep(&tmp, " "))) {
+			if (!*tok)
+				continue;
+			if (filter.params_count == WCN36XX_HAL_MAX_CMP_PER_FILTER ||
+			    wcn36xx_parse_filter_params(tok,
+					&filter.params[filter.params_count]))
+				return -EINVAL;
+			filter.params_count++;
+		}
+		if (!filter.params_count)
+			return -EINVAL;
+		filter.used = true;
+		first = last = id;
+	}
+
+	mutex_lock(&wcn->conf_mutex);
+	mutex_lock(&wcn->pkt_filter_lock);
+	for (i = first; i <= last; i++) {
+		slot = &wcn->pkt_filters[i];
+		if (!slot->used && clear)
+			continue;
+
+		list_for_each_entry(vif_priv, &wcn->vif_list, list) {
+			if (!vif_priv->sta_assoc)
+				continue;
+			if (slot->used)
+				wcn36xx_smd_clear_packet_filter(wcn,
+					wcn36xx_priv_to_vif(vif_priv), i);
+			if (!clear)
+				wcn36xx_smd_set_packet_filter(wcn,
+					wcn36xx_priv_to_vif(vif_priv), i,
+					&filter);
+		}
+
+		if (clear)
+			memset(slot, 0, sizeof(*slot));
+		else
+			*slot = filter;
+	}
+	mutex_unlock(&wcn->pkt_filter_lock);
+	mutex_unlock(&wcn->conf_mutex);
+
+	return count;
+}
+
+static const struct file_operations fops_wcn36xx_packet_filter = {
+	.open  =       simple_open,
+	.read  =       read_file_packet_filter,
+	.write =       write_file_packet_filter,
+};
+
+static void wcn36xx_fw_stats_rate(struct ani_global_class_a_stats_info *a,
+				  char *buf, size_t size)
+{
+	/* Legacy rates are in units of 500 kbit/s */
+	if (a->tx_rate_flags & HAL_TX_RATE_LEGACY)
+		scnprintf(buf, size, "%u.%u Mbps", a->tx_rate / 2,
+			  a->tx_rate & 1 ? 5 : 0);
+	else
+		scnprintf(buf, size, "mcs %u %s%s", a->mcs_index,
+			  a->tx_rate_flags & HAL_TX_RATE_HT40 ? "ht40" : "ht20",
+			  a->tx_rate_flags & HAL_TX_RATE_SGI ? " sgi" : "");
+}
+
+static ssize_t read_file_fw_stats(struct file *file, char __user *user_buf,
+				  size_t count, loff_t *ppos)
+{
+	struct wcn36xx *wcn = file->private_data;
+	struct wcn36xx_vif *vif_priv = NULL;
+	struct ani_summary_stats_info *sum;
+	struct wcn36xx_fw_stats *stats;
+	size_t len = 0, size = 4096;
+	char rate[32];
+	ssize_t ret;
+	char *buf;
+	int ac;
+
+	buf = kzalloc(size, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	/* Reading the file is an on demand poll */
+	wcn36xx_fw_stats_refresh(wcn, 0, false);
+
+	mutex_lock(&wcn->conf_mutex);
+	mutex_lock(&wcn->stats_lock);
+	list_for_each_entry(vif_priv, &wcn->vif_list, list) {
+		stats = &vif_priv->fw_stats;
+		len += scnprintf(buf + len, size - len,
+				 "vif %pM polls %u failures %u age %u ms\n",
+				 wcn36xx_priv_to_vif(vif_priv)->addr,
+				 stats->polls, stats->failures,
+				 stats->updated ?
+				 jiffies_to_msecs(jiffies - stats->updated) : 0);
+
+		if (stats->mask & HAL_SUMMARY_STATS_INFO) {
+			sum = &stats->summary;
+			len += scnprintf(buf + len, size - len,
+					 "ac  tx       retry    multi    fail\n");
+			for (ac = 0; ac < ARRAY_SIZE(sum->tx_frm_cnt); ac++)
+				len += scnprintf(buf + len, size - len,
+						 "%-3d %-8u %-8u %-8u %u\n", ac,
+						 sum->tx_frm_cnt[ac],
+						 sum->retry_cnt[ac],
+						 sum->multiple_retry_cnt[ac],
+						 sum->fail_cnt[ac]);
+			len += scnprintf(buf + len, size - len,
+					 "tx bytes %u ack fail %u rts ok %u fail %u\n"
+					 "rx %u dup %u discard %u fcs error %u\n",
+					 sum->tx_byte_cnt, sum->ack_fail_cnt,
+					 sum->rts_succ_cnt, sum->rts_fail_cnt,
+					 sum->rx_frm_cnt, sum->frm_dup_cnt,
+					 sum->rx_discard_cnt, sum->rx_error_cnt);
+		}
+
+		if (stats->mask & HAL_GLOBAL_CLASS_A_STATS_INFO) {
+			wcn36xx_fw_stats_rate(&stats->class_a, rate,
+					      sizeof(rate));
+			len += scnprintf(buf + len, size - len,
+					 "tx rate %s rx frag %u sync fail %u max power %u.%u dBm\n",
+					 rate, stats->class_a.rx_frag_cnt,
+					 stats->class_a.sync_fail_cnt,
+					 stats->class_a.max_pwr / 10,
+					 stats->class_a.max_pwr % 10);
+		}
+
+		if (stats->mask & HAL_PER_STA_STATS_INFO)
+			len += scnprintf(buf + len, size - len,
+					 "sta tx frag %u %u %u %u ampdu %u mpdu in ampdu %u\n",
+					 stats->per_sta.tx_frag_cnt[0],
+					 stats->per_sta.tx_frag_cnt[1],
+					 stats->per_sta.tx_frag_cnt[2],
+					 stats->per_sta.tx_frag_cnt[3],
+					 stats->per_sta.tx_ampdu_cnt,
+					 stats->per_sta.tx_mpdu_in_ampdu_cnt);
+	}
+	mutex_unlock(&wcn->stats_lock);
+	mutex_unlock(&wcn->conf_mutex);
+
+	ret = simple_read_from_buffer(user_buf, count, ppos, buf, len);
+	kfree(buf);
+	return ret;
+}
+
+static const struct file_operations fops_wcn36xx_fw_stats = {
+	.open  =       simple_open,
+	.read  =       read_file_fw_stats,
+};
+
+static const char * const wcn36xx_stat_names[WCN36XX_STAT_NUM] = {
+	[WCN36XX_STAT_TX_PACKETS]	= "tx packets",
+	[WCN36XX_STAT_TX_BYTES]		= "tx bytes",
+	[WCN36XX_STAT_TX_DROPPED]	= "tx dropped",
+	[WCN36XX_STAT_TX_RING_FULL]	= "tx ring full",
+	[WCN36XX_STAT_TX_STATUS_FAIL]	= "tx status fail",
+	[WCN36XX_STAT_RX_PACKETS]	= "rx packets",
+	[WCN36XX_STAT_RX_BYTES]		= "rx bytes",
+};
+
+static size_t wcn36xx_print_stats(struct wcn36xx_pcpu_stats __percpu *pcpu,
+				  char *buf, size_t size)
+{
+	u64 cnt[WCN36XX_STAT_NUM];
+	size_t len = 0;
+	int i;
+
+	wcn36xx_stats_read(pcpu, cnt);
+	for (i = 0; i < WCN36XX_STAT_NUM; i++)
+		len += scnprintf(buf + len, size - len, "%-16s%llu\n",
+				 wcn36xx_stat_names[i], cnt[i]);
+	return len;
+}
+
+static ssize_t read_file_data_stats(struct file *file, char __user *user_buf,
+				    size_t count, loff_t *ppos)
+{
+	struct wcn36xx *wcn = file->private_data;
+	struct wcn36xx_vif *vif_priv = NULL;
+	size_t len = 0, size = 2048;
+	ssize_t ret;
+	char *buf;
+
+	buf = kzalloc(size, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	mutex_lock(&wcn->conf_mutex);
+	list_for_each_entry(vif_priv, &wcn->vif_list, list) {
+		len += scnprintf(buf + len, size - len, "vif %pM\n",
+				 wcn36xx_priv_to_vif(vif_priv)->addr);
+		len += wcn36xx_print_stats(vif_priv->stats, buf + len,
+					   size - len);
+	}
+	mutex_unlock(&wcn->conf_mutex);
+
+	ret = simple_read_from_buffer(user_buf, count, ppos, buf, len);
+	kfree(buf);
+	return ret;
+}
+
+static const struct file_operations fops_wcn36xx_data_stats = {
+	.open  =       simple_open,
+	.read  =       read_file_data_stats,
+};
+
+#ifdef CONFIG_MAC80211_DEBUGFS
+static ssize_t read_file_sta_stats(struct file *file, char __user *user_buf,
+				   size_t count, loff_t *ppos)
+{
+	struct wcn36xx_sta *sta_priv = file->private_data;
+	char buf[512];
+	size_t len;
+
+	len = scnprintf(buf, sizeof(buf), "sta_index %d\n",
+			sta_priv->sta_index);
+	len += wcn36xx_print_stats(sta_priv->stats, buf + len,
+				   sizeof(buf) - len);
+
+	return simple_read_from_buffer(user_buf, count, ppos, buf, len);
+}
+
+static const struct file_operations fops_wcn36xx_sta_stats = {
+	.open  =       simple_open,
+	.read  =       read_file_sta_stats,
+};
+
+/* Station directories are created and removed by mac80211 */
+void wcn36xx_debugfs_sta_add(struct ieee80211_hw *hw,
+			     struct ieee80211_vif *vif,
+			     struct ieee80211_sta *sta,
+			     struct dentry *dir)
+{
+	debugfs_create_file("driver_stats", S_IRUSR, dir,
+			    wcn36xx_sta_to_priv(sta), &fops_wcn36xx_sta_stats);
+}
+#endif /* CONFIG_MAC80211_DEBUGFS */
+
 static ssize_t write_file_dump(struct file *file,
 				    const char __user *user_buf,
 				    size_t count, loff_t *ppos)
@@ -137,6 +595,143 @@ static const struct file_operations fops_wcn36xx_dump = {
 	.write =       write_file_dump,
 };
 
+static ssize_t read_file_hal_stats(struct file *file, char __user *user_buf,
+				   size_t count, loff_t *ppos)
+{
+	struct wcn36xx *wcn = file->private_data;
+	struct wcn36xx_hal_msg_stats stats;
+	size_t len = 0, size = 128 * WCN36XX_HAL_MSG_NUM;
+	ssize_t ret;
+	char *buf;
+	int i;
+
+	buf = kzalloc(size, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	len += scnprintf(buf + len, size - len,
+			 "%-32s %8s %10s %8s %8s %8s %8s\n",
+			 "message", "count", "bytes", "timeout",
+			 "min(us)", "avg(us)", "max(us)");
+
+	for (i = 0; i < WCN36XX_HAL_MSG_NUM; i++) {
+		wcn36xx_smd_stats_get(wcn, i, &stats);
+		if (!stats.count)
+			continue;
+
+		len += scnprintf(buf + len, size - len,
+				 "%-32s %8u %10llu %8u %8u %8llu %8u\n",
+				 wcn36xx_smd_msg_name(i), stats.count,
+				 stats.bytes, stats.timeouts,
+				 stats.lat_min,
+				 stats.completed ?
+				 div_u64(stats.lat_total, stats.completed) :
+				 0,
+				 stats.lat_max);
+	}
+
+	ret = simple_read_from_buffer(user_buf, count, ppos, buf, len);
+	kfree(buf);
+	return ret;
+}
+
+static ssize_t write_file_hal_stats(struct file *file,
+				    const char __user *user_buf,
+				    size_t count, loff_t *ppos)
+{
+	struct wcn36xx *wcn = file->private_data;
+
+	/* Any write resets the statistics */
+	wcn36xx_smd_stats_reset(wcn);
+
+	return count;
+}
+
+static const struct file_operations fops_wcn36xx_hal_stats = {
+	.open  =       simple_open,
+	.read  =       read_file_hal_stats,
+	.write =       write_file_hal_stats,
+};
+
+static ssize_t read_file_hal_latency(struct file *file, char __user *user_buf,
+				     size_t count, loff_t *ppos)
+{
+	struct wcn36xx *wcn = file->private_data;
+	struct wcn36xx_hal_msg_stats stats;
+	size_t len = 0, size = 256 * WCN36XX_HAL_MSG_NUM;
+	ssize_t ret;
+	char *buf;
+	int i, j;
+
+	buf = kzalloc(size, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	len += scnprintf(buf + len, size - len,
+			 "%-32s %8s %8s %8s %8s %8s  histogram (<%uus, x2 per bucket)\n",
+			 "message", "samples", "p50(us)", "p90(us)",
+			 "p99(us)", "tmo(ms)", WCN36XX_HAL_LAT_BASE_US);
+
+	for (i = 0; i < WCN36XX_HAL_MSG_NUM; i++) {
+		wcn36xx_smd_stats_get(wcn, i, &stats);
+		if (!stats.completed)
+			continue;
+
+		len += scnprintf(buf + len, size - len,
+				 "%-32s %8u %8u %8u %8u %8u ",
+				 wcn36xx_smd_msg_name(i), stats.completed,
+				 wcn36xx_smd_lat_percentile(&stats, 50),
+				 wcn36xx_smd_lat_percentile(&stats, 90),
+				 wcn36xx_smd_lat_percentile(&stats, 99),
+				 wcn36xx_smd_timeout(wcn, i));
+		for (j = 0; j < WCN36XX_HAL_LAT_BUCKETS; j++)
+			len += scnprintf(buf + len, size - len, " %u",
+					 stats.lat_hist[j]);
+		len += scnprintf(buf + len, size - len, "\n");
+	}
+
+	ret = simple_read_from_buffer(user_buf, count, ppos, buf, len);
+	kfree(buf);
+	return ret;
+}
+
+static const struct file_operations fops_wcn36xx_hal_latency = {
+	.open  =       simple_open,
+	.read  =       read_file_hal_latency,
+};
+
+static const char * const wcn36xx_start_phase_names[] = {
+	[WCN36XX_START_SMD_OPEN]	= "smd_open",
+	[WCN36XX_START_DXE_ALLOC]	= "dxe_alloc",
+	[WCN36XX_START_NV]		= "nv_download",
+	[WCN36XX_START_FW]		= "fw_start",
+	[WCN36XX_START_CAPS]		= "feat_caps",
+	[WCN36XX_START_DXE_WAIT]	= "dxe_alloc_wait",
+	[WCN36XX_START_DXE_INIT]	= "dxe_init",
+	[WCN36XX_START_TOTAL]		= "total",
+};
+
+static ssize_t read_file_start_timing(struct file *file, char __user *user_buf,
+				      size_t count, loff_t *ppos)
+{
+	struct wcn36xx *wcn = file->private_data;
+	char buf[48 * WCN36XX_START_PHASE_NUM];
+	size_t len = 0;
+	int i;
+
+	for (i = 0; i < WCN36XX_START_PHASE_NUM; i++)
+		len += scnprintf(buf + len, sizeof(buf) - len, "%-16s %8u us\n",
+				 wcn36xx_start_phase_names[i],
+				 wcn->start_phase_us[i]);
+
+	return simple_read_from_buffer(user_buf, count, ppos, buf, len);
+}
+
+static const struct file_operations fops_wcn36xx_start_timing = {
+	.open  =       simple_open,
+	.read  =       read_file_start_timing,
+};
+
 #define ADD_FILE(name, mode, fop, priv_data)		\
 	do {							\
 		struct dentry *d;				\
@@ -165,6 +760,15 @@ void wcn36xx_debugfs_init(struct wcn36xx *wcn)
 	ADD_FILE(bmps_switcher, S_IRUSR | S_IWUSR,
 		 &fops_wcn36xx_bmps, wcn);
 	ADD_FILE(dump, S_IWUSR, &fops_wcn36xx_dump, wcn);
+	ADD_FILE(hal_stats, S_IRUSR | S_IWUSR, &fops_wcn36xx_hal_stats, wcn);
+	ADD_FILE(hal_latency, S_IRUSR, &fops_wcn36xx_hal_latency, wcn);
+	ADD_FILE(start_timing, S_IRUSR, &fops_wcn36xx_start_timing, wcn);
+	ADD_FILE(pmc_stats, S_IRUSR, &fops_wcn36xx_pmc_stats, wcn);
+	ADD_FILE(offload, S_IRUSR, &fops_wcn36xx_offload, wcn);
+	ADD_FILE(packet_filter, S_IRUSR | S_IWUSR,
+		 &fops_wcn36xx_packet_filter, wcn);
+	ADD_FILE(fw_stats, S_IRUSR, &fops_wcn36xx_fw_stats, wcn);
+	ADD_FILE(data_stats, S_IRUSR, &fops_wcn36xx_data_stats, wcn);
 }
 
 void wcn36xx_debugfs_exit(struct wcn36xx *wcn)
@@ -32,10 +32,24 @@ struct wcn36xx_dfs_entry {
 	struct dentry *rootdir;
 	struct wcn36xx_dfs_file file_bmps_switcher;
 	struct wcn36xx_dfs_file file_dump;
+	struct wcn36xx_dfs_file file_hal_stats;
+	struct wcn36xx_dfs_file file_hal_latency;
+	struct wcn36xx_dfs_file file_start_timing;
+	struct wcn36xx_dfs_file file_pmc_stats;
+	struct wcn36xx_dfs_file file_offload;
+	struct wcn36xx_dfs_file file_packet_filter;
+	struct wcn36xx_dfs_file file_fw_stats;
+	struct wcn36xx_dfs_file file_data_stats;
 };
 
 void wcn36xx_debugfs_init(struct wcn36xx *wcn);
 void wcn36xx_debugfs_exit(struct wcn36xx *wcn);
+#ifdef CONFIG_MAC80211_DEBUGFS
+void wcn36xx_debugfs_sta_add(struct ieee80211_hw *hw,
+			     struct ieee80211_vif *vif,
+			     struct ieee80211_sta *sta,
+			     struct dentry *dir);
+#endif
 
 #else
 static inline void wcn36xx_debugfs_init(struct wcn36xx *wcn)
@@ -349,6 +349,15 @@ enum wcn36xx_hal_host_msg_type {
 	WCN36XX_HAL_DHCP_START_IND = 189,
 	WCN36XX_HAL_DHCP_STOP_IND = 190,
 
+	/* Scan Offload(hw) APIs */
+	WCN36XX_HAL_START_SCAN_OFFLOAD_REQ = 204,
+	WCN36XX_HAL_START_SCAN_OFFLOAD_RSP = 205,
+	WCN36XX_HAL_STOP_SCAN_OFFLOAD_REQ = 206,
+	WCN36XX_HAL_STOP_SCAN_OFFLOAD_RSP = 207,
+	WCN36XX_HAL_UPDATE_CHANNEL_LIST_REQ = 208,
+	WCN36XX_HAL_UPDATE_CHANNEL_LIST_RSP = 209,
+	WCN36XX_HAL_SCAN_OFFLOAD_IND = 210,
+
 	WCN36XX_HAL_MSG_MAX = WCN36XX_HAL_MSG_TYPE_MAX_ENUM_SIZE
 };
 
@@ -2147,14 +2156,14 @@ struct update_edca_params_req_msg {
 
 	/* Voice */
 	struct wcn36xx_hal_edca_param_record acvo;
-};
+} __packed;
 
 struct update_edca_params_rsp_msg {
 	struct wcn36xx_hal_msg_header header;
 
 	/* success or failure */
 	u32 status;
-};
+} __packed;
 
 struct dpu_stats_params {
 	/* Index of STA to which the statistics */
@@ -2186,7 +2195,7 @@ struct wcn36xx_hal_stats_req_msg {
 
 	/* Categories of stats requested as specified in eHalStatsMask */
 	u32 stats_mask;
-};
+} __packed;
 
 struct ani_summary_stats_info {
 	/* Total number of packets(per AC) that were successfully
@@ -2403,7 +2412,7 @@ struct wcn36xx_hal_stats_rsp_msg {
 
 	/* length of the entire request, includes the pStatsBuf length too */
 	u16 msg_len;
-};
+} __packed;
 
 struct wcn36xx_hal_set_link_state_req_msg {
 	struct wcn36xx_hal_msg_header header;
@@ -3149,7 +3158,7 @@ struct wcn36xx_hal_ns_offload_params {
 	/* slot index for this offload */
 	u32 slot_index;
 	u8 bss_index;
-};
+} __packed;
 
 struct wcn36xx_hal_host_offload_req {
 	u8 offload_Type;
@@ -3161,13 +3170,13 @@ struct wcn36xx_hal_host_offload_req {
 		u8 host_ipv4_addr[4];
 		u8 host_ipv6_addr[WCN36XX_HAL_IPV6_ADDR_LEN];
 	} u;
-};
+} __packed;
 
 struct wcn36xx_hal_host_offload_req_msg {
 	struct wcn36xx_hal_msg_header header;
 	struct wcn36xx_hal_host_offload_req host_offload_params;
 	struct wcn36xx_hal_ns_offload_params ns_offload_params;
-};
+} __packed;
 
 /* Packet Types. */
 #define WCN36XX_HAL_KEEP_ALIVE_NULL_PKT              1
@@ -3224,6 +3233,19 @@ struct wcn36xx_hal_exit_uapsd_req_msg {
 	u8 bss_index;
 };
 
+struct wcn36xx_hal_update_uapsd_params_req_msg {
+	struct wcn36xx_hal_msg_header header;
+
+	/* STA index */
+	u8 sta_index;
+
+	/* U-APSD Flags: 1b per AC, encoded as in config_sta_params */
+	u8 uapsd_ac_mask;
+
+	/* Max SP Length */
+	u32 max_sp_len;
+} __packed;
+
 #define WCN36XX_HAL_WOWL_BCAST_PATTERN_MAX_SIZE 128
 #define WCN36XX_HAL_WOWL_BCAST_MAX_NUM_PATTERNS 16
 
@@ -3553,6 +3575,13 @@ struct wcn36xx_hal_set_uapsd_ac_params_rsp_msg {
 	u32 status;
 };
 
+struct wcn36xx_hal_update_uapsd_params_rsp_msg {
+	struct wcn36xx_hal_msg_header header;
+
+	/* success or failure */
+	u32 status;
+};
+
 struct wcn36xx_hal_configure_rxp_filter_rsp_msg {
 	struct wcn36xx_hal_msg_header header;
 
@@ -3849,7 +3878,7 @@ struct wcn36xx_hal_del_ba_ind_msg {
 
 	/* TO SUPPORT BT-AMP */
 	u8 bssid[ETH_ALEN];
-};
+} __packed;
 
 /* PNO Messages */
 
@@ -3955,7 +3984,7 @@ struct scan_timer {
 	/* e.g: 2 3 4 0 - it will wait 2s between consecutive scans for 3
 	 * times - after that it will wait 4s between consecutive scans
 	 * until disabled */
-};
+} __packed;
 
 /* The network parameters to be sent to the PNO algorithm */
 struct scan_timers_type {
@@ -3970,7 +3999,7 @@ struct scan_timers_type {
 	 * once PNO reaches the end of the array it will continue scanning
 	 * at intervals presented by the last value */
 	struct scan_timer values[WCN36XX_HAL_PNO_MAX_SCAN_TIMERS];
-};
+} __packed;
 
 /* Preferred network list request */
 struct set_pref_netw_list_req {
@@ -4021,7 +4050,7 @@ struct network_type_new {
 
 	/* Indicates the RSSI threshold for the network to be considered */
 	u8 rssi_threshold;
-};
+} __packed;
 
 /* Preferred network list request new */
 struct set_pref_netw_list_req_new {
@@ -4049,7 +4078,7 @@ struct set_pref_netw_list_req_new {
 	/* Probe template for 5GHz band */
 	u16 band_5g_probe_size;
 	u8 band_5g_probe_template[WCN36XX_HAL_PNO_MAX_PROBE_SIZE];
-};
+} __packed;
 
 /* Preferred network list response */
 struct set_pref_netw_list_resp {
@@ -4058,7 +4087,7 @@ struct set_pref_netw_list_resp {
 	/* status of the request - just to indicate that PNO has
 	 * acknowledged the request and will start scanning */
 	u32 status;
-};
+} __packed;
 
 /* Preferred network found indication */
 struct pref_netw_found_ind {
@@ -4070,7 +4099,7 @@ struct pref_netw_found_ind {
 
 	/* Indicates the RSSI */
 	u8 rssi;
-};
+} __packed;
 
 /* RSSI Filter request */
 struct set_rssi_filter_req {
@@ -4240,7 +4269,7 @@ struct wcn36xx_hal_rcv_pkt_filter_params {
 
 	/* Mask to be applied on the received packet data before compare */
 	u8 data_mask[WCN36XX_HAL_PROTOCOL_DATA_LEN];
-};
+} __packed;
 
 struct wcn36xx_hal_sessionized_rcv_pkt_filter_cfg_type {
 	u8 id;
@@ -4249,7 +4278,13 @@ struct wcn36xx_hal_sessionized_rcv_pkt_filter_cfg_type {
 	u32 coleasce_time;
 	u8 bss_index;
 	struct wcn36xx_hal_rcv_pkt_filter_params params[1];
-};
+} __packed;
+
+/* Used instead of the request below when firmware has SLM_SESSIONIZATION */
+struct wcn36xx_hal_set_sessionized_rcv_pkt_filter_req_msg {
+	struct wcn36xx_hal_msg_header header;
+	struct wcn36xx_hal_sessionized_rcv_pkt_filter_cfg_type cfg;
+} __packed;
 
 struct wcn36xx_hal_set_rcv_pkt_filter_req_msg {
 	struct wcn36xx_hal_msg_header header;
@@ -4259,7 +4294,7 @@ struct wcn36xx_hal_set_rcv_pkt_filter_req_msg {
 	u8 params_count;
 	u32 coalesce_time;
 	struct wcn36xx_hal_rcv_pkt_filter_params params[1];
-};
+} __packed;
 
 struct wcn36xx_hal_rcv_flt_mc_addr_list_type {
 	/* from start of the respective frame header */
@@ -4288,7 +4323,7 @@ struct wcn36xx_hal_rcv_flt_pkt_match_cnt_req_msg {
 struct wcn36xx_hal_rcv_flt_pkt_match_cnt {
 	u8 id;
 	u32 match_cnt;
-};
+} __packed;
 
 struct wcn36xx_hal_rcv_flt_pkt_match_cnt_rsp_msg {
 	struct wcn36xx_hal_msg_header header;
@@ -4300,7 +4335,7 @@ struct wcn36xx_hal_rcv_flt_pkt_match_cnt_rsp_msg {
 	struct wcn36xx_hal_rcv_flt_pkt_match_cnt
 		matches[WCN36XX_HAL_MAX_NUM_FILTERS];
 	u8 bss_index;
-};
+} __packed;
 
 struct wcn36xx_hal_rcv_flt_pkt_clear_param {
 	/* only valid for response message */
@@ -4524,7 +4559,7 @@ struct wcn36xx_hal_gtk_offload_req_msg {
 	u64 key_replay_counter;
 
 	u8 bss_index;
-};
+} __packed;
 
 struct wcn36xx_hal_gtk_offload_rsp_msg {
 	struct wcn36xx_hal_msg_header header;
@@ -4562,7 +4597,7 @@ struct wcn36xx_hal_gtk_offload_get_info_rsp_msg {
 	u32 igtk_rekey_count;
 
 	u8 bss_index;
-};
+} __packed;
 
 struct dhcp_info {
 	/* Indicates the device mode which indicates about the DHCP activity */
@@ -4663,4 +4698,98 @@ struct stats_class_b_ind {
 	u32 rx_time_total;
 };
 
+#define WCN36XX_HAL_SCAN_OFFLOAD_MAX_BSSID	4
+#define WCN36XX_HAL_SCAN_OFFLOAD_MAX_SSID	10
+#define WCN36XX_HAL_SCAN_OFFLOAD_MAX_CHANNELS	80
+
+enum wcn36xx_hal_scan_type {
+	WCN36XX_HAL_SCAN_TYPE_PASSIVE = 0x00,
+	WCN36XX_HAL_SCAN_TYPE_ACTIVE = WCN36XX_HAL_MAX_ENUM_SIZE
+};
+
+struct wcn36xx_hal_start_scan_offload_req_msg {
+	struct wcn36xx_hal_msg_header header;
+
+	/* BSSIDs hot list */
+	u8 num_bssid;
+	u8 bssids[WCN36XX_HAL_SCAN_OFFLOAD_MAX_BSSID][ETH_ALEN];
+
+	/* Directed probe-requests will be sent for listed SSIDs */
+	u8 num_ssid;
+	struct wcn36xx_hal_mac_ssid ssids[WCN36XX_HAL_SCAN_OFFLOAD_MAX_SSID];
+
+	/* Report AP with hidden ssid */
+	u8 scan_hidden;
+
+	/* Self MAC address */
+	u8 mac[ETH_ALEN];
+
+	/* BSS type */
+	enum wcn36xx_hal_bss_type bss_type;
+
+	/* Scan type */
+	enum wcn36xx_hal_scan_type scan_type;
+
+	/* Minimum scanning time on each channel (ms) */
+	u32 min_ch_time;
+
+	/* Maximum scanning time on each channel (ms) */
+	u32 max_ch_time;
+
+	/* Is a p2p search */
+	u8 p2p_search;
+
+	/* Channels to scan */
+	u8 num_channel;
+	u8 channels[WCN36XX_HAL_SCAN_OFFLOAD_MAX_CHANNELS];
+
+	/* Following the 'ie_len', there should be ie_len bytes of probe
+	 * request IEs i.e. u8[ie_len] */
+	u16 ie_len;
+} __packed;
+
+struct wcn36xx_hal_start_scan_offload_rsp_msg {
+	struct wcn36xx_hal_msg_header header;
+
+	/* success or failure */
+	u32 status;
+} __packed;
+
+enum wcn36xx_hal_scan_offload_ind_type {
+	/* scan started */
+	WCN36XX_HAL_SCAN_IND_STARTED = 0x01,
+	/* scan completed */
+	WCN36XX_HAL_SCAN_IND_COMPLETED = 0x02,
+	/* moved to foreign channel */
+	WCN36XX_HAL_SCAN_IND_FOREIGN_CHANNEL = 0x08,
+	/* scan request has been dequeued */
+	WCN36XX_HAL_SCAN_IND_DEQUEUED = 0x10,
+	/* preempted by other high priority scan */
+	WCN36XX_HAL_SCAN_IND_PREEMPTED = 0x20,
+	/* scan start failed */
+	WCN36XX_HAL_SCAN_IND_FAILED = 0x40,
+	/* scan restarted */
+	WCN36XX_HAL_SCAN_IND_RESTARTED = 0x80,
+	WCN36XX_HAL_SCAN_IND_MAX = WCN36XX_HAL_MAX_ENUM_SIZE
+};
+
+struct wcn36xx_hal_scan_offload_ind {
+	struct wcn36xx_hal_msg_header header;
+
+	u32 type;
+	u32 channel_mhz;
+	u32 scan_id;
+} __packed;
+
+struct wcn36xx_hal_stop_scan_offload_req_msg {
+	struct wcn36xx_hal_msg_header header;
+} __packed;
+
+struct wcn36xx_hal_stop_scan_offload_rsp_msg {
+	struct wcn36xx_hal_msg_header header;
+
+	/* success or failure */
+	u32 status;
+} __packed;
+
 #endif /* _HAL_H_ */
@@ -20,12 +20,53 @@
 #include <linux/module.h>
 #include <linux/firmware.h>
 #include <linux/platform_device.h>
+#include <linux/delay.h>
+#include <net/addrconf.h>
 #include "wcn36xx.h"
 
 unsigned int wcn36xx_dbg_mask;
 module_param_named(debug_mask, wcn36xx_dbg_mask, uint, 0644);
 MODULE_PARM_DESC(debug_mask, "Debugging mask");
 
+static unsigned int bg_scan_max_offchan = 120;
+module_param(bg_scan_max_offchan, uint, 0644);
+MODULE_PARM_DESC(bg_scan_max_offchan,
+		 "Max time in ms off the operating channel while associated");
+
+static unsigned int bg_scan_home_time = 100;
+module_param(bg_scan_home_time, uint, 0644);
+MODULE_PARM_DESC(bg_scan_home_time,
+		 "Time in ms on the operating channel between scan groups");
+
+static unsigned int bg_scan_busy_frames = 10;
+module_param(bg_scan_busy_frames, uint, 0644);
+MODULE_PARM_DESC(bg_scan_busy_frames,
+		 "Data frames per home dwell that shrink the off-channel budget");
+
+static bool filter_noise;
+module_param(filter_noise, bool, 0444);
+MODULE_PARM_DESC(filter_noise,
+		 "Drop NetBIOS, SSDP and mDNS traffic in firmware");
+
+static unsigned int ba_rx_win = WCN36XX_AGGR_BUFFER_SIZE;
+module_param(ba_rx_win, uint, 0444);
+MODULE_PARM_DESC(ba_rx_win, "RX block-ack window advertised to peers");
+
+static unsigned int ba_tx_win = WCN36XX_AGGR_BUFFER_SIZE;
+module_param(ba_tx_win, uint, 0444);
+MODULE_PARM_DESC(ba_tx_win,
+		 "Largest TX block-ack window, further capped by the peer");
+
+static unsigned int ba_timeout_tu;
+module_param(ba_timeout_tu, uint, 0644);
+MODULE_PARM_DESC(ba_timeout_tu,
+		 "Inactivity in TU after which firmware deletes a BA session, 0 never");
+
+static unsigned int fw_stats_ms;
+module_param(fw_stats_ms, uint, 0644);
+MODULE_PARM_DESC(fw_stats_ms,
+		 "Period in ms of firmware statistics polling, 0 on demand only");
+
 #define CHAN2G(_freq, _idx) { \
 	.band = IEEE80211_BAND_2GHZ, \
 	.center_freq = (_freq), \
@@ -166,7 +207,8 @@ static struct ieee80211_supported_band wcn_band_5ghz = {
 #ifdef CONFIG_PM
 
 static const struct wiphy_wowlan_support wowlan_support = {
-	.flags = WIPHY_WOWLAN_ANY
+	.flags = WIPHY_WOWLAN_ANY |
+		 WIPHY_WOWLAN_SUPPORTS_GTK_REKEY
 };
 
 #endif
@@ -233,38 +275,71 @@ static void wcn36xx_detect_chip_version(struct wcn36xx *wcn)
 	}
 }
 
-static int wcn36xx_start(struct ieee80211_hw *hw)
+static void wcn36xx_start_phase(struct wcn36xx *wcn,
+				enum wcn36xx_start_phase phase, ktime_t *ts)
 {
-	struct wcn36xx *wcn = hw->priv;
-	int ret;
+	ktime_t now = ktime_get();
 
-	wcn36xx_dbg(WCN36XX_DBG_MAC, "mac start\n");
+	wcn->start_phase_us[phase] = ktime_us_delta(now, *ts);
+	*ts = now;
+}
 
-	/* SMD initialization */
-	ret = wcn36xx_smd_open(wcn);
-	if (ret) {
-		wcn36xx_err("Failed to open smd channel: %d\n", ret);
-		goto out_err;
-	}
+/*
+ * DXE pools and control blocks are host memory only, so they are
+ * allocated from a work item while start waits for the firmware.
+ */
+static void wcn36xx_dxe_alloc_work(struct work_struct *work)
+{
+	struct wcn36xx *wcn = container_of(work, struct wcn36xx,
+					   dxe_alloc_work);
+	ktime_t ts = ktime_get();
+	int ret;
 
 	/* Allocate memory pools for Mgmt BD headers and Data BD headers */
 	ret = wcn36xx_dxe_allocate_mem_pools(wcn);
 	if (ret) {
 		wcn36xx_err("Failed to alloc DXE mempool: %d\n", ret);
-		goto out_smd_close;
+		goto out;
 	}
 
 	ret = wcn36xx_dxe_alloc_ctl_blks(wcn);
 	if (ret) {
 		wcn36xx_err("Failed to alloc DXE ctl blocks: %d\n", ret);
-		goto out_free_dxe_pool;
+		wcn36xx_dxe_free_mem_pools(wcn);
 	}
+out:
+	wcn->dxe_alloc_ret = ret;
+	wcn36xx_start_phase(wcn, WCN36XX_START_DXE_ALLOC, &ts);
+}
+
+static int wcn36xx_start(struct ieee80211_hw *hw)
+{
+	struct wcn36xx *wcn = hw->priv;
+	ktime_t start, ts;
+	int ret;
+
+	wcn36xx_dbg(WCN36XX_DBG_MAC, "mac start\n");
+
+	memset(wcn->start_phase_us, 0, sizeof(wcn->start_phase_us));
+	atomic_set(&wcn->ba_sessions, 0);
+	atomic_set(&wcn->ba_buffers, 0);
+	start = ts = ktime_get();
+
+	/* SMD initialization */
+	ret = wcn36xx_smd_open(wcn);
+	if (ret) {
+		wcn36xx_err("Failed to open smd channel: %d\n", ret);
+		goto out_err;
+	}
+	wcn36xx_start_phase(wcn, WCN36XX_START_SMD_OPEN, &ts);
+
+	queue_work(system_unbound_wq, &wcn->dxe_alloc_work);
 
 	wcn->hal_buf = kmalloc(WCN36XX_HAL_BUF_SIZE, GFP_KERNEL);
 	if (!wcn->hal_buf) {
 		wcn36xx_err("Failed to allocate smd buf\n");
 		ret = -ENOMEM;
-		goto out_free_dxe_ctl;
+		goto out_free_dxe;
 	}
 
 	ret = wcn36xx_smd_load_nv(wcn);
@@ -272,12 +347,14 @@ static int wcn36xx_start(struct ieee80211_hw *hw)
 		wcn36xx_err("Failed to push NV to chip\n");
 		goto out_free_smd_buf;
 	}
+	wcn36xx_start_phase(wcn, WCN36XX_START_NV, &ts);
 
 	ret = wcn36xx_smd_start(wcn);
 	if (ret) {
 		wcn36xx_err("Failed to start chip\n");
 		goto out_free_smd_buf;
 	}
+	wcn36xx_start_phase(wcn, WCN36XX_START_FW, &ts);
 
 	if (!wcn36xx_is_fw_version(wcn, 1, 2, 2, 24)) {
 		ret = wcn36xx_smd_feature_caps_exchange(wcn);
@@ -289,6 +366,13 @@ static int wcn36xx_start(struct ieee80211_hw *hw)
 
 	wcn36xx_detect_chip_version(wcn);
 	wcn36xx_smd_update_cfg(wcn, WCN36XX_HAL_CFG_ENABLE_MC_ADDR_LIST, 1);
+	wcn36xx_start_phase(wcn, WCN36XX_START_CAPS, &ts);
+
+	flush_work(&wcn->dxe_alloc_work);
+	ret = wcn->dxe_alloc_ret;
+	if (ret)
+		goto out_smd_stop;
+	wcn36xx_start_phase(wcn, WCN36XX_START_DXE_WAIT, &ts);
 
 	/* DMA channel initialization */
 	ret = wcn36xx_dxe_init(wcn);
@@ -296,6 +380,19 @@ static int wcn36xx_start(struct ieee80211_hw *hw)
 		wcn36xx_err("DXE init failed\n");
 		goto out_smd_stop;
 	}
+	wcn36xx_start_phase(wcn, WCN36XX_START_DXE_INIT, &ts);
+	wcn36xx_start_phase(wcn, WCN36XX_START_TOTAL, &start);
+
+	wcn36xx_dbg(WCN36XX_DBG_MAC,
+		    "mac start took %uus: smd %u nv %u fw %u caps %u dxe alloc %u (waited %u) dxe init %u\n",
+		    wcn->start_phase_us[WCN36XX_START_TOTAL],
+		    wcn->start_phase_us[WCN36XX_START_SMD_OPEN],
+		    wcn->start_phase_us[WCN36XX_START_NV],
+		    wcn->start_phase_us[WCN36XX_START_FW],
+		    wcn->start_phase_us[WCN36XX_START_CAPS],
+		    wcn->start_phase_us[WCN36XX_START_DXE_ALLOC],
+		    wcn->start_phase_us[WCN36XX_START_DXE_WAIT],
+		    wcn->start_phase_us[WCN36XX_START_DXE_INIT]);
 
 	wcn36xx_debugfs_init(wcn);
 
@@ -308,11 +405,13 @@ out_smd_stop:
 	wcn36xx_smd_stop(wcn);
 out_free_smd_buf:
 	kfree(wcn->hal_buf);
-out_free_dxe_pool:
-	wcn36xx_dxe_free_mem_pools(wcn);
-out_free_dxe_ctl:
-	wcn36xx_dxe_free_ctl_blks(wcn);
-out_smd_close:
+out_free_dxe:
+	/* The allocation work frees its own memory if it failed */
+	flush_work(&wcn->dxe_alloc_work);
+	if (!wcn->dxe_alloc_ret) {
+		wcn36xx_dxe_free_mem_pools(wcn);
+		wcn36xx_dxe_free_ctl_blks(wcn);
+	}
 	wcn36xx_smd_close(wcn);
 out_err:
 	return ret;
@@ -324,6 +423,8 @@ static void wcn36xx_stop(struct ieee80211_hw *hw)
 
 	wcn36xx_dbg(WCN36XX_DBG_MAC, "mac stop\n");
 
+	wcn36xx_tx_amsdu_stop(wcn);
+	cancel_delayed_work_sync(&wcn->stats_work);
 	wcn36xx_debugfs_exit(wcn);
 	wcn36xx_smd_stop(wcn);
 	wcn36xx_dxe_deinit(wcn);
@@ -356,6 +457,64 @@ static int wcn36xx_config(struct ieee80211_hw *hw, u32 changed)
 	return 0;
 }
 
+static size_t wcn36xx_mc_list_size(const struct wcn36xx_mc_list *list)
+{
+	return sizeof(*list) + list->count * ETH_ALEN;
+}
+
+static bool wcn36xx_mc_list_equal(const struct wcn36xx_mc_list *a,
+				  const struct wcn36xx_mc_list *b)
+{
+	if (!a || !b)
+		return a == b;
+	return a->count == b->count &&
+	       !memcmp(a->addr, b->addr, a->count * ETH_ALEN);
+}
+
+/* Program the wanted list unless the vif already has it, under mc_lock */
+static void wcn36xx_mc_list_sync(struct wcn36xx *wcn,
+				 struct ieee80211_vif *vif)
+{
+	struct wcn36xx_vif *vif_priv = wcn36xx_vif_to_priv(vif);
+	struct wcn36xx_mc_list *copy = NULL;
+
+	if (vif_priv->mc_valid &&
+	    wcn36xx_mc_list_equal(vif_priv->mc_list, wcn->mc_list)) {
+		wcn36xx_dbg(WCN36XX_DBG_MAC, "mac mc list unchanged\n");
+		return;
+	}
+
+	if (wcn->mc_list) {
+		copy = kmemdup(wcn->mc_list,
+			       wcn36xx_mc_list_size(wcn->mc_list), GFP_KERNEL);
+		if (!copy)
+			return;
+	}
+
+	kfree(vif_priv->mc_list);
+	vif_priv->mc_list = NULL;
+	vif_priv->mc_valid = false;
+
+	if (wcn36xx_smd_set_mc_list(wcn, vif, wcn->mc_list)) {
+		kfree(copy);
+		return;
+	}
+	vif_priv->mc_list = copy;
+	vif_priv->mc_valid = true;
+}
+
+static void wcn36xx_mc_list_reset(struct wcn36xx *wcn,
+				  struct ieee80211_vif *vif)
+{
+	struct wcn36xx_vif *vif_priv = wcn36xx_vif_to_priv(vif);
+
+	mutex_lock(&wcn->mc_lock);
+	kfree(vif_priv->mc_list);
+	vif_priv->mc_list = NULL;
+	vif_priv->mc_valid = false;
+	mutex_unlock(&wcn->mc_lock);
+}
+
 #define WCN36XX_SUPPORTED_FILTERS (FIF_PROMISC_IN_BSS | \
 				   FIF_ALLMULTI)
 
@@ -363,7 +522,7 @@ static void wcn36xx_configure_filter(struct ieee80211_hw *hw,
 				     unsigned int changed,
 				     unsigned int *total, u64 multicast)
 {
-	struct wcn36xx_hal_rcv_flt_mc_addr_list_type *fp;
+	struct wcn36xx_mc_list *list = (void *)(unsigned long)multicast;
 	struct wcn36xx *wcn = hw->priv;
 	struct wcn36xx_vif *tmp;
 	struct ieee80211_vif *vif = NULL;
@@ -372,44 +531,58 @@ static void wcn36xx_configure_filter(struct ieee80211_hw *hw,
 
 	*total &= WCN36XX_SUPPORTED_FILTERS;
 
-	fp = (void *)(unsigned long)multicast;
+	/* Too many groups for firmware, accept all of them instead */
+	if (list && list->overflow)
+		*total |= FIF_ALLMULTI;
+
+	if (*total & (FIF_ALLMULTI | FIF_PROMISC_IN_BSS)) {
+		kfree(list);
+		list = NULL;
+	}
+
+	mutex_lock(&wcn->mc_lock);
+	kfree(wcn->mc_list);
+	wcn->mc_list = list;
+
 	list_for_each_entry(tmp, &wcn->vif_list, list) {
 		vif = wcn36xx_priv_to_vif(tmp);
 
 		/* FW handles MC filtering only when connected as STA */
-		if (*total & (FIF_ALLMULTI | FIF_PROMISC_IN_BSS))
-			wcn36xx_smd_set_mc_list(wcn, vif, NULL);
-		else if (NL80211_IFTYPE_STATION == vif->type && tmp->sta_assoc)
-			wcn36xx_smd_set_mc_list(wcn, vif, fp);
+		if (NL80211_IFTYPE_STATION == vif->type && tmp->sta_assoc)
+			wcn36xx_mc_list_sync(wcn, vif);
 	}
-	kfree(fp);
+	mutex_unlock(&wcn->mc_lock);
 }
 
 static u64 wcn36xx_prepare_multicast(struct ieee80211_hw *hw,
 				     struct netdev_hw_addr_list *mc_list)
 {
-	struct wcn36xx_hal_rcv_flt_mc_addr_list_type *fp;
+	struct wcn36xx_mc_list *list;
 	struct netdev_hw_addr *ha;
+	int count = netdev_hw_addr_list_count(mc_list);
+	bool overflow = count > WCN36XX_HAL_MAX_NUM_MULTICAST_ADDRESS;
+
+	wcn36xx_dbg(WCN36XX_DBG_MAC, "mac prepare multicast list %d%s\n",
+		    count, overflow ? " overflow" : "");
+
+	if (overflow)
+		count = 0;
 
-	wcn36xx_dbg(WCN36XX_DBG_MAC, "mac prepare multicast list\n");
-	fp = kzalloc(sizeof(*fp), GFP_ATOMIC);
-	if (!fp) {
+	list = kzalloc(sizeof(*list) + count * ETH_ALEN, GFP_ATOMIC);
+	if (!list) {
 		wcn36xx_err("Out of memory setting filters.\n");
 		return 0;
 	}
 
-	fp->mc_addr_count = 0;
-	/* update multicast filtering parameters */
-	if (netdev_hw_addr_list_count(mc_list) <=
-	    WCN36XX_HAL_MAX_NUM_MULTICAST_ADDRESS) {
+	list->overflow = overflow;
+	if (!overflow) {
 		netdev_hw_addr_list_for_each(ha, mc_list) {
-			memcpy(fp->mc_addr[fp->mc_addr_count],
-					ha->addr, ETH_ALEN);
-			fp->mc_addr_count++;
+			memcpy(list->addr[list->count], ha->addr, ETH_ALEN);
+			list->count++;
 		}
 	}
 
-	return (u64)(unsigned long)fp;
+	return (u64)(unsigned long)list;
 }
 
 static void wcn36xx_tx(struct ieee80211_hw *hw,
@@ -422,6 +595,9 @@ static void wcn36xx_tx(struct ieee80211_hw *hw,
 	if (control->sta)
 		sta_priv = wcn36xx_sta_to_priv(control->sta);
 
+	if (sta_priv && wcn36xx_tx_amsdu(wcn, sta_priv, skb))
+		return;
+
 	if (wcn36xx_start_tx(wcn, sta_priv, skb))
 		ieee80211_free_txskb(wcn->hw, skb);
 }
@@ -543,20 +719,272 @@ out:
 	return ret;
 }
 
-static void wcn36xx_sw_scan_start(struct ieee80211_hw *hw)
+static void wcn36xx_scan_send_probes(struct wcn36xx *wcn,
+				     struct ieee80211_vif *vif,
+				     struct cfg80211_scan_request *req,
+				     enum ieee80211_band band)
+{
+	struct ieee80211_tx_info *info;
+	struct sk_buff *skb;
+	int i;
+
+	for (i = 0; i < req->n_ssids; i++) {
+		skb = ieee80211_probereq_get(wcn->hw, vif, req->ssids[i].ssid,
+					     req->ssids[i].ssid_len,
+					     req->ie_len);
+		if (!skb)
+			return;
+
+		if (req->ie_len)
+			memcpy(skb_put(skb, req->ie_len), req->ie, req->ie_len);
+
+		info = IEEE80211_SKB_CB(skb);
+		memset(info, 0, sizeof(*info));
+		info->control.vif = vif;
+		info->band = band;
+
+		if (wcn36xx_start_tx(wcn, NULL, skb))
+			ieee80211_free_txskb(wcn->hw, skb);
+	}
+}
+
+static bool wcn36xx_scan_aborted(struct wcn36xx *wcn)
+{
+	bool aborted;
+
+	mutex_lock(&wcn->scan_lock);
+	aborted = wcn->scan_aborted;
+	mutex_unlock(&wcn->scan_lock);
+
+	return aborted;
+}
+
+/*
+ * Associated station vif whose data traffic must survive the scan. Only
+ * valid while conf_mutex is held, it is looked up again for every group.
+ */
+static struct ieee80211_vif *wcn36xx_scan_bss_vif(struct wcn36xx *wcn)
+{
+	struct ieee80211_vif *vif;
+	struct wcn36xx_vif *tmp;
+
+	lockdep_assert_held(&wcn->conf_mutex);
+
+	list_for_each_entry(tmp, &wcn->vif_list, list) {
+		vif = wcn36xx_priv_to_vif(tmp);
+		if (vif->type == NL80211_IFTYPE_STATION && tmp->sta_assoc)
+			return vif;
+	}
+	return NULL;
+}
+
+/*
+ * Used when the firmware does not support scan offload. The channels are
+ * walked here instead of from mac80211 so that each one costs a single
+ * START/END_SCAN pair instead of a channel switch per vif. The walk sleeps
+ * through every dwell so it runs on scan_wq, not the mac80211 workqueue.
+ *
+ * While associated the scan runs in the background: channels are scanned
+ * in groups no longer than the off-channel budget, the AP is told about
+ * power save around each group and data is served on the operating
+ * channel in between. The budget shrinks while there is traffic during
+ * the home dwell and grows back to bg_scan_max_offchan when idle.
+ */
+static void wcn36xx_hw_scan_worker(struct work_struct *work)
+{
+	struct wcn36xx *wcn = container_of(work, struct wcn36xx, scan_work);
+	struct cfg80211_scan_request *req = wcn->scan_req;
+	struct ieee80211_vif *vif = wcn->scan_vif;
+	struct ieee80211_vif *bss_vif;
+	unsigned int budget = bg_scan_max_offchan;
+	unsigned int spent, dwell, load;
+	struct ieee80211_channel *chan;
+	bool aborted = false;
+	int i = 0;
+
+	mutex_lock(&wcn->conf_mutex);
+	bss_vif = wcn36xx_scan_bss_vif(wcn);
+	mutex_unlock(&wcn->conf_mutex);
+
+	wcn36xx_dbg(WCN36XX_DBG_MAC, "mac80211 scan %d channels worker%s\n",
+		    req->n_channels, bss_vif ? " (background)" : "");
+
+	wcn->scan_bg = !!bss_vif;
+	for (;;) {
+		aborted = wcn36xx_scan_aborted(wcn);
+		if (aborted || i >= req->n_channels)
+			break;
+
+		mutex_lock(&wcn->conf_mutex);
+		bss_vif = wcn36xx_scan_bss_vif(wcn);
+		wcn->scan_bg = !!bss_vif;
+		wcn36xx_smd_init_scan(wcn, HAL_SYS_MODE_SCAN, bss_vif);
+		mutex_unlock(&wcn->conf_mutex);
+
+		for (spent = 0; i < req->n_channels; i++) {
+			chan = req->channels[i];
+			if (req->n_ssids && !(chan->flags & IEEE80211_CHAN_NO_IR))
+				dwell = WCN36XX_SCAN_ACTIVE_DWELL;
+			else
+				dwell = WCN36XX_SCAN_PASSIVE_DWELL;
+
+			/* At least one channel per group */
+			if (bss_vif && spent && spent + dwell > budget)
+				break;
+
+			aborted = wcn36xx_scan_aborted(wcn);
+			if (aborted)
+				break;
+
+			wcn->scan_band = chan->band;
+			wcn->scan_freq = chan->center_freq;
+
+			wcn36xx_smd_start_scan(wcn, chan->hw_value);
+			if (dwell == WCN36XX_SCAN_ACTIVE_DWELL)
+				wcn36xx_scan_send_probes(wcn, vif, req,
+							 chan->band);
+			msleep(dwell);
+			wcn36xx_smd_end_scan(wcn, chan->hw_value);
+			spent += dwell;
+		}
+		wcn->scan_freq = 0;
+
+		/* The AP was told about power save only if still associated */
+		mutex_lock(&wcn->conf_mutex);
+		if (bss_vif != wcn36xx_scan_bss_vif(wcn))
+			bss_vif = NULL;
+		wcn36xx_smd_finish_scan(wcn, HAL_SYS_MODE_SCAN, bss_vif);
+		mutex_unlock(&wcn->conf_mutex);
+
+		/* Disassociated mid scan: finish in the foreground */
+		if (!bss_vif) {
+			wcn->scan_bg = false;
+			continue;
+		}
+		if (aborted || i >= req->n_channels)
+			continue;
+
+		/* Serve data on the operating channel before the next group */
+		atomic_set(&wcn->scan_traffic, 0);
+		msleep(bg_scan_home_time);
+		load = atomic_read(&wcn->scan_traffic);
+		if (load >= bg_scan_busy_frames)
+			budget = max_t(unsigned int, budget / 2,
+				       WCN36XX_SCAN_ACTIVE_DWELL);
+		else
+			budget = min(budget * 2, bg_scan_max_offchan);
+
+		wcn36xx_dbg(WCN36XX_DBG_MAC,
+			    "bg scan %d/%d channels, %u frames at home, next budget %ums\n",
+			    i, req->n_channels, load, budget);
+	}
+	wcn->scan_bg = false;
+
+	mutex_lock(&wcn->scan_lock);
+	wcn->scan_req = NULL;
+	mutex_unlock(&wcn->scan_lock);
+
+	ieee80211_scan_completed(wcn->hw, aborted);
+}
+
+static int wcn36xx_hw_scan(struct ieee80211_hw *hw,
+			   struct ieee80211_vif *vif,
+			   struct cfg80211_scan_request *req)
+{
+	struct wcn36xx *wcn = hw->priv;
+	int ret;
+
+	mutex_lock(&wcn->scan_lock);
+	if (wcn->scan_req) {
+		mutex_unlock(&wcn->scan_lock);
+		return -EBUSY;
+	}
+
+	wcn->scan_aborted = false;
+	wcn->scan_req = req;
+	wcn->scan_vif = vif;
+	wcn->scan_next = 0;
+	mutex_unlock(&wcn->scan_lock);
+
+	if (!get_feat_caps(wcn->fw_feat_caps, SCAN_OFFLOAD)) {
+		queue_work(wcn->scan_wq, &wcn->scan_work);
+		return 0;
+	}
+
+	/* Results are reported by the firmware via SCAN_OFFLOAD_IND */
+	ret = wcn36xx_smd_start_hw_scan(wcn, vif, req);
+	if (ret) {
+		mutex_lock(&wcn->scan_lock);
+		wcn->scan_req = NULL;
+		mutex_unlock(&wcn->scan_lock);
+	}
+	return ret;
+}
+
+static void wcn36xx_cancel_hw_scan(struct ieee80211_hw *hw,
+				   struct ieee80211_vif *vif)
+{
+	struct wcn36xx *wcn = hw->priv;
+
+	mutex_lock(&wcn->scan_lock);
+	wcn->scan_aborted = true;
+	mutex_unlock(&wcn->scan_lock);
+
+	if (get_feat_caps(wcn->fw_feat_caps, SCAN_OFFLOAD)) {
+		/* ieee80211_scan_completed is called from the indication */
+		wcn36xx_smd_stop_hw_scan(wcn);
+		return;
+	}
+
+	/* A worker that already ran has completed the scan itself */
+	if (cancel_work_sync(&wcn->scan_work)) {
+		mutex_lock(&wcn->scan_lock);
+		wcn->scan_req = NULL;
+		mutex_unlock(&wcn->scan_lock);
+		ieee80211_scan_completed(wcn->hw, true);
+	}
+}
+
+static int wcn36xx_sched_scan_start(struct ieee80211_hw *hw,
+				    struct ieee80211_vif *vif,
+				    struct cfg80211_sched_scan_request *req,
+				    struct ieee80211_sched_scan_ies *ies)
 {
 	struct wcn36xx *wcn = hw->priv;
+	u8 channels[WCN36XX_HAL_PNO_MAX_NETW_CHANNELS];
+	int i, ret;
+
+	wcn36xx_dbg(WCN36XX_DBG_MAC, "mac sched scan start %d match sets\n",
+		    req->n_match_sets);
 
-	wcn36xx_smd_init_scan(wcn, HAL_SYS_MODE_SCAN);
-	wcn36xx_smd_start_scan(wcn);
+	/* Firmware without PNO was already seen, do not bother it again */
+	if (wcn->pno_known && !wcn->pno_new_api)
+		return -EOPNOTSUPP;
+
+	/* PNO scans with these parameters, the response tells the format */
+	for (i = 0; i < req->n_channels && i < ARRAY_SIZE(channels); i++)
+		channels[i] = req->channels[i]->hw_value;
+
+	ret = wcn36xx_smd_update_scan_params(wcn, channels, i);
+	if (ret)
+		return ret;
+
+	if (!wcn->pno_new_api) {
+		wcn36xx_warn("Firmware does not support preferred network offload\n");
+		return -EOPNOTSUPP;
+	}
+
+	return wcn36xx_smd_set_pref_netw_list(wcn, vif, req, ies);
 }
 
-static void wcn36xx_sw_scan_complete(struct ieee80211_hw *hw)
+static void wcn36xx_sched_scan_stop(struct ieee80211_hw *hw,
+				    struct ieee80211_vif *vif)
 {
 	struct wcn36xx *wcn = hw->priv;
 
-	wcn36xx_smd_end_scan(wcn);
-	wcn36xx_smd_finish_scan(wcn, HAL_SYS_MODE_SCAN);
+	wcn36xx_dbg(WCN36XX_DBG_MAC, "mac sched scan stop\n");
+
+	wcn36xx_smd_stop_pno(wcn);
 }
 
 static void wcn36xx_update_allowed_rates(struct ieee80211_sta *sta,
@@ -625,6 +1053,241 @@ void wcn36xx_set_default_rates(struct wcn36xx_hal_supported_rates *rates)
 		sizeof(*ofdm_rates) * WCN36XX_HAL_NUM_OFDM_RATES);
 	rates->supported_mcs_set[0] = 0xFF;
 }
+/* UDP destination ports of the broadcast chatter dropped by filter_noise */
+static const u16 wcn36xx_noise_ports[] = {
+	137,	/* NetBIOS name service */
+	138,	/* NetBIOS datagram service */
+	1900,	/* SSDP */
+	5353,	/* mDNS */
+};
+
+static void wcn36xx_pkt_filter_defaults(struct wcn36xx *wcn)
+{
+	struct wcn36xx_hal_rcv_pkt_filter_params *params;
+	struct wcn36xx_pkt_filter *filter;
+	int i;
+
+	if (!filter_noise)
+		return;
+
+	for (i = 0; i < ARRAY_SIZE(wcn36xx_noise_ports); i++) {
+		filter = &wcn->pkt_filters[i];
+		filter->used = true;
+		filter->type = HAL_RCV_FILTER_TYPE_FILTER_PKT;
+		filter->params_count = 1;
+
+		params = &filter->params[0];
+		params->protocol_layer = HAL_FILTER_PROTO_TYPE_UDP;
+		params->cmp_flag = HAL_FILTER_CMP_TYPE_EQUAL;
+		/* Destination port of the UDP header */
+		params->data_offset = 2;
+		params->data_length = 2;
+		params->compare_data[0] = wcn36xx_noise_ports[i] >> 8;
+		params->compare_data[1] = wcn36xx_noise_ports[i] & 0xff;
+	}
+}
+
+static void wcn36xx_pkt_filter_install(struct wcn36xx *wcn,
+				       struct ieee80211_vif *vif)
+{
+	int i;
+
+	/* Filters are per BSS in firmware and go away with it */
+	mutex_lock(&wcn->pkt_filter_lock);
+	for (i = 0; i < WCN36XX_HAL_MAX_NUM_FILTERS; i++)
+		if (wcn->pkt_filters[i].used)
+			wcn36xx_smd_set_packet_filter(wcn, vif, i,
+						      &wcn->pkt_filters[i]);
+	mutex_unlock(&wcn->pkt_filter_lock);
+}
+
+static void wcn36xx_arp_offload_update(struct wcn36xx *wcn,
+				       struct ieee80211_vif *vif)
+{
+	struct wcn36xx_vif *vif_priv = wcn36xx_vif_to_priv(vif);
+	struct ieee80211_bss_conf *bss_conf = &vif->bss_conf;
+	__be32 addr = 0;
+
+	/*
+	 * Firmware answers for a single address, with more than one the
+	 * host keeps replying itself.
+	 */
+	if (bss_conf->arp_addr_cnt == 1)
+		addr = bss_conf->arp_addr_list[0];
+
+	if (!wcn36xx_smd_arp_offload(wcn, vif, addr)) {
+		vif_priv->offload.arp_addr = addr;
+		vif_priv->offload.arp_updates++;
+	}
+}
+
+static void wcn36xx_ns_offload_update(struct wcn36xx *wcn,
+				      struct ieee80211_vif *vif)
+{
+	struct wcn36xx_host_offload *offload =
+		&wcn36xx_vif_to_priv(vif)->offload;
+	struct in6_addr addrs[WCN36XX_NS_OFFLOAD_ADDRS];
+	int count;
+
+	spin_lock_bh(&offload->lock);
+	count = offload->ns_addr_cnt;
+	memcpy(addrs, offload->ns_addr, sizeof(addrs));
+	spin_unlock_bh(&offload->lock);
+
+	if (!wcn36xx_smd_ns_offload(wcn, vif, addrs, count))
+		offload->ns_updates++;
+}
+
+static void wcn36xx_ns_offload_work(struct work_struct *work)
+{
+	struct wcn36xx *wcn = container_of(work, struct wcn36xx,
+					   ns_offload_work);
+	struct wcn36xx_vif *vif_priv;
+
+	mutex_lock(&wcn->conf_mutex);
+	list_for_each_entry(vif_priv, &wcn->vif_list, list)
+		if (vif_priv->sta_assoc)
+			wcn36xx_ns_offload_update(wcn,
+					wcn36xx_priv_to_vif(vif_priv));
+	mutex_unlock(&wcn->conf_mutex);
+}
+
+#if IS_ENABLED(CONFIG_IPV6)
+static void wcn36xx_ipv6_addr_change(struct ieee80211_hw *hw,
+				     struct ieee80211_vif *vif,
+				     struct inet6_dev *idev)
+{
+	struct wcn36xx *wcn = hw->priv;
+	struct wcn36xx_vif *vif_priv = wcn36xx_vif_to_priv(vif);
+	struct wcn36xx_host_offload *offload = &vif_priv->offload;
+	struct inet6_ifaddr *ifa;
+	int count = 0;
+
+	wcn36xx_dbg(WCN36XX_DBG_MAC, "mac ipv6 addr change vif %p\n", vif);
+
+	/* Called from an atomic notifier, firmware is updated from a work */
+	spin_lock_bh(&offload->lock);
+	read_lock_bh(&idev->lock);
+	list_for_each_entry(ifa, &idev->addr_list, if_list) {
+		if (ifa->flags & IFA_F_TENTATIVE)
+			continue;
+		offload->ns_addr[count++] = ifa->addr;
+		if (count == WCN36XX_NS_OFFLOAD_ADDRS)
+			break;
+	}
+	read_unlock_bh(&idev->lock);
+	offload->ns_addr_cnt = count;
+	spin_unlock_bh(&offload->lock);
+
+	if (vif_priv->sta_assoc)
+		ieee80211_queue_work(hw, &wcn->ns_offload_work);
+}
+#endif
+
+/* Station whose counters GET_STATS returns for the vif */
+static u8 wcn36xx_fw_stats_sta_index(struct wcn36xx_vif *vif_priv)
+{
+	struct ieee80211_vif *vif = wcn36xx_priv_to_vif(vif_priv);
+	struct ieee80211_sta *sta;
+	u8 sta_index = vif_priv->self_sta_index;
+
+	if (NL80211_IFTYPE_STATION != vif->type || !vif_priv->sta_assoc)
+		return sta_index;
+
+	rcu_read_lock();
+	sta = ieee80211_find_sta(vif, vif->bss_conf.bssid);
+	if (sta)
+		sta_index = wcn36xx_sta_to_priv(sta)->bss_sta_index;
+	rcu_read_unlock();
+
+	return sta_index;
+}
+
+/**
+ * wcn36xx_fw_stats_refresh() - read firmware counters of every active vif
+ *
+ * @wcn: device
+ * @max_age_ms: counters read more recently than this are kept, 0 forces
+ * a new read.
+ * @poll: called from the periodic poll, which leaves vifs in BMPS asleep.
+ *
+ * Only vifs with a BSS in firmware are read. Also restarts the periodic
+ * poll if fw_stats_ms was set since it last ran.
+ */
+void wcn36xx_fw_stats_refresh(struct wcn36xx *wcn, unsigned int max_age_ms,
+			      bool poll)
+{
+	struct wcn36xx_fw_stats *stats;
+	struct wcn36xx_vif *vif_priv;
+
+	mutex_lock(&wcn->conf_mutex);
+	mutex_lock(&wcn->stats_lock);
+	list_for_each_entry(vif_priv, &wcn->vif_list, list) {
+		stats = &vif_priv->fw_stats;
+		if (vif_priv->bss_index == WCN36XX_HAL_BSS_INVALID_IDX)
+			continue;
+		if (poll && vif_priv->pw_state == WCN36XX_BMPS)
+			continue;
+		if (stats->updated && max_age_ms &&
+		    time_before(jiffies, stats->updated +
+				msecs_to_jiffies(max_age_ms)))
+			continue;
+
+		stats->polls++;
+		if (wcn36xx_smd_get_stats(wcn,
+				wcn36xx_fw_stats_sta_index(vif_priv), stats))
+			stats->failures++;
+		else
+			stats->updated = jiffies ?: 1;
+	}
+	mutex_unlock(&wcn->stats_lock);
+
+	if (fw_stats_ms && !list_empty(&wcn->vif_list) &&
+	    !delayed_work_pending(&wcn->stats_work))
+		ieee80211_queue_delayed_work(wcn->hw, &wcn->stats_work,
+					     msecs_to_jiffies(fw_stats_ms));
+	mutex_unlock(&wcn->conf_mutex);
+}
+
+static void wcn36xx_fw_stats_work(struct work_struct *work)
+{
+	struct wcn36xx *wcn = container_of(to_delayed_work(work),
+					   struct wcn36xx, stats_work);
+
+	if (fw_stats_ms)
+		wcn36xx_fw_stats_refresh(wcn, 0, true);
+}
+
+static int wcn36xx_get_stats(struct ieee80211_hw *hw,
+			     struct ieee80211_low_level_stats *stats)
+{
+	struct wcn36xx *wcn = hw->priv;
+	struct ani_summary_stats_info *summary;
+	struct wcn36xx_vif *vif_priv;
+
+	wcn36xx_dbg(WCN36XX_DBG_MAC, "mac get stats\n");
+
+	/* A read within the polling period is as fresh as a new one */
+	wcn36xx_fw_stats_refresh(wcn, fw_stats_ms, false);
+
+	memset(stats, 0, sizeof(*stats));
+	mutex_lock(&wcn->conf_mutex);
+	mutex_lock(&wcn->stats_lock);
+	list_for_each_entry(vif_priv, &wcn->vif_list, list) {
+		if (!(vif_priv->fw_stats.mask & HAL_SUMMARY_STATS_INFO))
+			continue;
+		summary = &vif_priv->fw_stats.summary;
+		stats->dot11ACKFailureCount += summary->ack_fail_cnt;
+		stats->dot11RTSFailureCount += summary->rts_fail_cnt;
+		stats->dot11FCSErrorCount += summary->rx_error_cnt;
+		stats->dot11RTSSuccessCount += summary->rts_succ_cnt;
+	}
+	mutex_unlock(&wcn->stats_lock);
+	mutex_unlock(&wcn->conf_mutex);
+
+	return 0;
+}
+
 static void wcn36xx_bss_info_changed(struct ieee80211_hw *hw,
 				     struct ieee80211_vif *vif,
 				     struct ieee80211_bss_conf *bss_conf,
@@ -639,6 +1302,8 @@ static void wcn36xx_bss_info_changed(struct ieee80211_hw *hw,
 	wcn36xx_dbg(WCN36XX_DBG_MAC, "mac bss info changed vif %p changed 0x%08x\n",
 		    vif, changed);
 
+	mutex_lock(&wcn->conf_mutex);
+
 	if (changed & BSS_CHANGED_BEACON_INFO) {
 		wcn36xx_dbg(WCN36XX_DBG_MAC,
 			    "mac bss changed dtim period %d\n",
@@ -651,11 +1316,7 @@ static void wcn36xx_bss_info_changed(struct ieee80211_hw *hw,
 		wcn36xx_dbg(WCN36XX_DBG_MAC,
 			    "mac bss PS set %d\n",
 			    bss_conf->ps);
-		if (bss_conf->ps) {
-			wcn36xx_pmc_enter_bmps_state(wcn, vif);
-		} else {
-			wcn36xx_pmc_exit_bmps_state(wcn, vif);
-		}
+		wcn36xx_pmc_set_ps(wcn, vif, bss_conf->ps);
 	}
 
 	if (changed & BSS_CHANGED_BSSID) {
@@ -725,7 +1386,24 @@ static void wcn36xx_bss_info_changed(struct ieee80211_hw *hw,
 			 * place where AID is available.
 			 */
 			wcn36xx_smd_config_sta(wcn, vif, sta);
+			wcn36xx_pmc_uapsd_assoc(wcn, vif, sta_priv->sta_index);
 			rcu_read_unlock();
+
+			/* Only beacons with changed IEs reach the host now */
+			wcn36xx_smd_add_bcn_filter(wcn, vif);
+			wcn36xx_arp_offload_update(wcn, vif);
+			wcn36xx_ns_offload_update(wcn, vif);
+			wcn36xx_pkt_filter_install(wcn, vif);
+
+			/* New BSS in firmware, program the multicast list */
+			mutex_lock(&wcn->mc_lock);
+			vif_priv->mc_valid = false;
+			wcn36xx_mc_list_sync(wcn, vif);
+			mutex_unlock(&wcn->mc_lock);
+			if (bss_conf->cqm_rssi_thold)
+				wcn36xx_smd_set_rssi_thresh(wcn,
+					bss_conf->cqm_rssi_thold,
+					bss_conf->cqm_rssi_hyst);
 		} else {
 			wcn36xx_dbg(WCN36XX_DBG_MAC,
 				    "disassociated bss %pM vif %pM AID=%d\n",
@@ -733,6 +1411,9 @@ static void wcn36xx_bss_info_changed(struct ieee80211_hw *hw,
 				    vif->addr,
 				    bss_conf->aid);
 			vif_priv->sta_assoc = false;
+			vif_priv->rekey_data.valid = false;
+			wcn36xx_mc_list_reset(wcn, vif);
+			wcn36xx_smd_rem_bcn_filter(wcn);
 			wcn36xx_smd_set_link_st(wcn,
 						bss_conf->bssid,
 						vif->addr,
@@ -740,6 +1421,19 @@ static void wcn36xx_bss_info_changed(struct ieee80211_hw *hw,
 		}
 	}
 
+	if (changed & BSS_CHANGED_ARP_FILTER && vif_priv->sta_assoc) {
+		wcn36xx_dbg(WCN36XX_DBG_MAC, "mac bss arp filter %d addrs\n",
+			    bss_conf->arp_addr_cnt);
+		wcn36xx_arp_offload_update(wcn, vif);
+	}
+
+	if (changed & BSS_CHANGED_CQM && vif_priv->sta_assoc) {
+		wcn36xx_dbg(WCN36XX_DBG_MAC, "mac bss cqm rssi %d hyst %d\n",
+			    bss_conf->cqm_rssi_thold, bss_conf->cqm_rssi_hyst);
+		wcn36xx_smd_set_rssi_thresh(wcn, bss_conf->cqm_rssi_thold,
+					    bss_conf->cqm_rssi_hyst);
+	}
+
 	if (changed & BSS_CHANGED_AP_PROBE_RESP) {
 		wcn36xx_dbg(WCN36XX_DBG_MAC, "mac bss changed ap probe resp\n");
 		skb = ieee80211_proberesp_get(hw, vif);
@@ -787,7 +1481,7 @@ static void wcn36xx_bss_info_changed(struct ieee80211_hw *hw,
 		}
 	}
 out:
-	return;
+	mutex_unlock(&wcn->conf_mutex);
 }
 
 /* this is required when using IEEE80211_HW_HAS_RATE_CONTROL */
@@ -800,6 +1494,44 @@ static int wcn36xx_set_rts_threshold(struct ieee80211_hw *hw, u32 value)
 	return 0;
 }
 
+static int wcn36xx_conf_tx(struct ieee80211_hw *hw,
+			   struct ieee80211_vif *vif, u16 ac,
+			   const struct ieee80211_tx_queue_params *params)
+{
+	struct wcn36xx *wcn = hw->priv;
+	struct wcn36xx_vif *vif_priv = wcn36xx_vif_to_priv(vif);
+	struct wcn36xx_hal_edca_param_record *edca = &vif_priv->edca[ac];
+	u8 acs = vif_priv->uapsd_acs;
+
+	wcn36xx_dbg(WCN36XX_DBG_MAC,
+		    "mac conf tx ac %d aifs %d cw %d-%d txop %d acm %d uapsd %d\n",
+		    ac, params->aifs, params->cw_min, params->cw_max,
+		    params->txop, params->acm, params->uapsd);
+
+	edca->aci.aci = wcn36xx_ac_to_aci(ac);
+	edca->aci.acm = params->acm;
+	edca->aci.aifsn = params->aifs;
+	/* Firmware takes the contention windows as exponents */
+	edca->cw.min = fls(params->cw_min);
+	edca->cw.max = fls(params->cw_max);
+	edca->txop_limit = params->txop;
+	vif_priv->edca_valid = true;
+
+	/* Before the BSS exists config_bss carries the parameters */
+	if (vif_priv->bss_index != WCN36XX_HAL_BSS_INVALID_IDX)
+		wcn36xx_smd_update_edca_params(wcn, vif);
+
+	if (params->uapsd)
+		acs |= BIT(ac);
+	else
+		acs &= ~BIT(ac);
+
+	if (acs != vif_priv->uapsd_acs)
+		wcn36xx_pmc_set_uapsd(wcn, vif, acs);
+
+	return 0;
+}
+
 static void wcn36xx_remove_interface(struct ieee80211_hw *hw,
 				     struct ieee80211_vif *vif)
 {
@@ -807,7 +1539,20 @@ static void wcn36xx_remove_interface(struct ieee80211_hw *hw,
 	struct wcn36xx_vif *vif_priv = wcn36xx_vif_to_priv(vif);
 	wcn36xx_dbg(WCN36XX_DBG_MAC, "mac remove interface vif %p\n", vif);
 
-	list_del(&vif_priv->list);
+	wcn36xx_pmc_deinit(wcn, vif);
+	cancel_work_sync(&wcn->ns_offload_work);
+	cancel_delayed_work_sync(&wcn->stats_work);
+	wcn36xx_mc_list_reset(wcn, vif);
+	mutex_lock(&wcn->conf_mutex);
+	list_del_rcu(&vif_priv->list);
+	mutex_unlock(&wcn->conf_mutex);
+	/* The RX path may still be looking at the vif */
+	synchronize_rcu();
+	free_percpu(vif_priv->stats);
+	vif_priv->stats = NULL;
+	if (fw_stats_ms && !list_empty(&wcn->vif_list))
+		ieee80211_queue_delayed_work(hw, &wcn->stats_work,
+					     msecs_to_jiffies(fw_stats_ms));
 	wcn36xx_smd_delete_sta_self(wcn, vif->addr);
 }
 
@@ -829,8 +1574,29 @@ static int wcn36xx_add_interface(struct ieee80211_hw *hw,
 		return -EOPNOTSUPP;
 	}
 
-	list_add(&vif_priv->list, &wcn->vif_list);
+	/*
+	 * Firmware filters unchanged beacons and watches the RSSI, so
+	 * mac80211 must not rely on seeing every beacon.
+	 */
+	if (NL80211_IFTYPE_STATION == vif->type)
+		vif->driver_flags |= IEEE80211_VIF_BEACON_FILTER |
+				     IEEE80211_VIF_SUPPORTS_CQM_RSSI;
+
+	vif_priv->stats = wcn36xx_stats_alloc();
+	if (!vif_priv->stats)
+		return -ENOMEM;
+
+	vif_priv->bss_index = WCN36XX_HAL_BSS_INVALID_IDX;
+	wcn36xx_pmc_init(wcn, vif);
+	spin_lock_init(&vif_priv->offload.lock);
+	memset(&vif_priv->fw_stats, 0, sizeof(vif_priv->fw_stats));
+	mutex_lock(&wcn->conf_mutex);
+	list_add_rcu(&vif_priv->list, &wcn->vif_list);
+	mutex_unlock(&wcn->conf_mutex);
 	wcn36xx_smd_add_sta_self(wcn, vif);
+	if (fw_stats_ms)
+		ieee80211_queue_delayed_work(hw, &wcn->stats_work,
+					     msecs_to_jiffies(fw_stats_ms));
 
 	return 0;
 }
@@ -841,10 +1607,19 @@ static int wcn36xx_sta_add(struct ieee80211_hw *hw, struct ieee80211_vif *vif,
 	struct wcn36xx *wcn = hw->priv;
 	struct wcn36xx_vif *vif_priv = wcn36xx_vif_to_priv(vif);
 	struct wcn36xx_sta *sta_priv = wcn36xx_sta_to_priv(sta);
+	int i;
+
 	wcn36xx_dbg(WCN36XX_DBG_MAC, "mac sta add vif %p sta %pM\n",
 		    vif, sta->addr);
 
+	sta_priv->stats = wcn36xx_stats_alloc();
+	if (!sta_priv->stats)
+		return -ENOMEM;
+
 	spin_lock_init(&sta_priv->ampdu_lock);
+	INIT_LIST_HEAD(&sta_priv->amsdu_node);
+	for (i = 0; i < IEEE80211_NUM_TIDS; i++)
+		__skb_queue_head_init(&sta_priv->amsdu_q[i]);
 	sta_priv->vif = vif_priv;
 	/*
 	 * For STA mode HW will be configured on BSS_CHANGED_ASSOC because
@@ -868,8 +1643,11 @@ static int wcn36xx_sta_remove(struct ieee80211_hw *hw,
 	wcn36xx_dbg(WCN36XX_DBG_MAC, "mac sta remove vif %p sta %pM index %d\n",
 		    vif, sta->addr, sta_priv->sta_index);
 
+	wcn36xx_tx_amsdu_purge(wcn, sta_priv);
 	wcn36xx_smd_delete_sta(wcn, sta_priv->sta_index);
 	sta_priv->vif = NULL;
+	free_percpu(sta_priv->stats);
+	sta_priv->stats = NULL;
 	return 0;
 }
 
@@ -878,27 +1656,81 @@ static int wcn36xx_sta_remove(struct ieee80211_hw *hw,
 static int wcn36xx_suspend(struct ieee80211_hw *hw, struct cfg80211_wowlan *wow)
 {
 	struct wcn36xx *wcn = hw->priv;
+	struct wcn36xx_vif *vif_priv;
 
 	wcn36xx_dbg(WCN36XX_DBG_MAC, "mac suspend\n");
 
 	flush_workqueue(wcn->hal_ind_wq);
 	wcn36xx_smd_set_power_params(wcn, true);
+
+	/* Firmware answers group rekeys while the host sleeps */
+	list_for_each_entry(vif_priv, &wcn->vif_list, list)
+		if (vif_priv->sta_assoc && vif_priv->rekey_data.valid)
+			wcn36xx_smd_gtk_offload(wcn,
+				wcn36xx_priv_to_vif(vif_priv), true);
 	return 0;
 }
 
 static int wcn36xx_resume(struct ieee80211_hw *hw)
 {
 	struct wcn36xx *wcn = hw->priv;
+	struct wcn36xx_vif *vif_priv;
+	struct ieee80211_vif *vif;
 
 	wcn36xx_dbg(WCN36XX_DBG_MAC, "mac resume\n");
 
 	flush_workqueue(wcn->hal_ind_wq);
 	wcn36xx_smd_set_power_params(wcn, false);
+
+	list_for_each_entry(vif_priv, &wcn->vif_list, list) {
+		if (!vif_priv->sta_assoc || !vif_priv->rekey_data.valid)
+			continue;
+		vif = wcn36xx_priv_to_vif(vif_priv);
+		wcn36xx_smd_gtk_offload_get_info(wcn, vif);
+		wcn36xx_smd_gtk_offload(wcn, vif, false);
+	}
 	return 0;
 }
 
+static void wcn36xx_set_rekey_data(struct ieee80211_hw *hw,
+				   struct ieee80211_vif *vif,
+				   struct cfg80211_gtk_rekey_data *data)
+{
+	struct wcn36xx_vif *vif_priv = wcn36xx_vif_to_priv(vif);
+
+	wcn36xx_dbg(WCN36XX_DBG_MAC, "mac set rekey data vif %p\n", vif);
+
+	memcpy(vif_priv->rekey_data.kek, data->kek, NL80211_KEK_LEN);
+	memcpy(vif_priv->rekey_data.kck, data->kck, NL80211_KCK_LEN);
+	vif_priv->rekey_data.replay_ctr =
+		be64_to_cpup((__be64 *)data->replay_ctr);
+	vif_priv->rekey_data.valid = true;
+}
+
 #endif
 
+/*
+ * Reserve up to @want firmware BA buffers, settling for no fewer than
+ * @min. Returns the number reserved, 0 when the budget cannot cover @min.
+ */
+static u16 wcn36xx_ba_buf_get(struct wcn36xx *wcn, u16 want, u16 min)
+{
+	int over;
+
+	over = atomic_add_return(want, &wcn->ba_buffers) -
+		WCN36XX_MAX_BA_BUFFERS;
+	if (over <= 0)
+		return want;
+
+	if (want - over >= min) {
+		atomic_sub(over, &wcn->ba_buffers);
+		return want - over;
+	}
+
+	atomic_sub(want, &wcn->ba_buffers);
+	return 0;
+}
+
 static int wcn36xx_ampdu_action(struct ieee80211_hw *hw,
 		    struct ieee80211_vif *vif,
 		    enum ieee80211_ampdu_mlme_action action,
@@ -907,41 +1739,127 @@ static int wcn36xx_ampdu_action(struct ieee80211_hw *hw,
 {
 	struct wcn36xx *wcn = hw->priv;
 	struct wcn36xx_sta *sta_priv = wcn36xx_sta_to_priv(sta);
+	u8 sta_index = get_sta_index(vif, sta_priv);
+	u8 session_id;
+	u16 rx_tids, win;
+	bool active;
+	int state;
+	int ret;
 
 	wcn36xx_dbg(WCN36XX_DBG_MAC, "mac ampdu action action %d tid %d\n",
 		    action, tid);
 
 	switch (action) {
 	case IEEE80211_AMPDU_RX_START:
-		sta_priv->tid = tid;
-		wcn36xx_smd_add_ba_session(wcn, sta, tid, ssn, 0,
-			get_sta_index(vif, sta_priv));
-		wcn36xx_smd_add_ba(wcn);
-		wcn36xx_smd_trigger_ba(wcn, get_sta_index(vif, sta_priv));
+		if (atomic_inc_return(&wcn->ba_sessions) >
+		    WCN36XX_MAX_BA_SESSIONS) {
+			atomic_dec(&wcn->ba_sessions);
+			return -EBUSY;
+		}
+
+		/* The peer was promised ba_rx_win, so take all of it or none */
+		win = wcn36xx_ba_buf_get(wcn, ba_rx_win, ba_rx_win);
+		if (!win) {
+			atomic_dec(&wcn->ba_sessions);
+			return -EBUSY;
+		}
+
+		ret = wcn36xx_smd_add_ba_session(wcn, sta, tid, ssn, 0,
+						 sta_index, win,
+						 ba_timeout_tu);
+		if (ret)
+			goto out_rx_put;
+
+		spin_lock_bh(&sta_priv->ampdu_lock);
+		session_id = sta_priv->rx_ba_session[tid];
+		spin_unlock_bh(&sta_priv->ampdu_lock);
+
+		ret = wcn36xx_smd_add_ba(wcn, session_id, win);
+		if (ret) {
+			wcn36xx_smd_del_ba(wcn, tid, 0, sta_index);
+			goto out_rx_put;
+		}
+
+		spin_lock_bh(&sta_priv->ampdu_lock);
+		sta_priv->rx_ba_tids |= BIT(tid);
+		sta_priv->rx_ba_buf[tid] = win;
+		rx_tids = sta_priv->rx_ba_tids;
+		spin_unlock_bh(&sta_priv->ampdu_lock);
+
+		wcn36xx_smd_trigger_ba(wcn, sta_index, session_id, rx_tids);
 		break;
 	case IEEE80211_AMPDU_RX_STOP:
-		wcn36xx_smd_del_ba(wcn, tid, get_sta_index(vif, sta_priv));
+		spin_lock_bh(&sta_priv->ampdu_lock);
+		active = sta_priv->rx_ba_tids & BIT(tid);
+		sta_priv->rx_ba_tids &= ~BIT(tid);
+		win = sta_priv->rx_ba_buf[tid];
+		sta_priv->rx_ba_buf[tid] = 0;
+		spin_unlock_bh(&sta_priv->ampdu_lock);
+
+		/* Sessions the firmware tore down itself are already gone */
+		if (active) {
+			wcn36xx_smd_del_ba(wcn, tid, 0, sta_index);
+			atomic_sub(win, &wcn->ba_buffers);
+			atomic_dec(&wcn->ba_sessions);
+		}
 		break;
 	case IEEE80211_AMPDU_TX_START:
+		/* The peer's window is not known yet, hold the most we use */
+		win = wcn36xx_ba_buf_get(wcn, ba_tx_win, WCN36XX_BA_MIN_WIN);
+		if (!win) {
+			if (atomic_xchg(&sta_priv->ampdu[tid].state,
+					WCN36XX_AMPDU_NONE) !=
+			    WCN36XX_AMPDU_NONE)
+				atomic_dec(&wcn->ba_sessions);
+			return -EBUSY;
+		}
+
 		spin_lock_bh(&sta_priv->ampdu_lock);
-		sta_priv->ampdu_state[tid] = WCN36XX_AMPDU_START;
+		sta_priv->tx_ba_buf[tid] = win;
 		spin_unlock_bh(&sta_priv->ampdu_lock);
 
+		/* Frames held for A-MSDU go out ahead of the aggregates */
+		wcn36xx_tx_amsdu_flush(wcn, sta_priv);
+
+		/* Sessions not started by wcn36xx_tx_start_ampdu() count too */
+		if (atomic_xchg(&sta_priv->ampdu[tid].state,
+				WCN36XX_AMPDU_START) == WCN36XX_AMPDU_NONE)
+			atomic_inc(&wcn->ba_sessions);
+
 		ieee80211_start_tx_ba_cb_irqsafe(vif, sta->addr, tid);
 		break;
 	case IEEE80211_AMPDU_TX_OPERATIONAL:
+		atomic_set(&sta_priv->ampdu[tid].state,
+			   WCN36XX_AMPDU_OPERATIONAL);
+
+		/* Give back what the peer's negotiated window does not need */
 		spin_lock_bh(&sta_priv->ampdu_lock);
-		sta_priv->ampdu_state[tid] = WCN36XX_AMPDU_OPERATIONAL;
+		win = sta_priv->tx_ba_buf[tid];
+		if (buf_size && buf_size < win) {
+			atomic_sub(win - buf_size, &wcn->ba_buffers);
+			win = buf_size;
+			sta_priv->tx_ba_buf[tid] = win;
+		}
 		spin_unlock_bh(&sta_priv->ampdu_lock);
 
-		wcn36xx_smd_add_ba_session(wcn, sta, tid, ssn, 1,
-			get_sta_index(vif, sta_priv));
+		wcn36xx_smd_add_ba_session(wcn, sta, tid, ssn, 1, sta_index,
+					   win, ba_timeout_tu);
 		break;
 	case IEEE80211_AMPDU_TX_STOP_FLUSH:
 	case IEEE80211_AMPDU_TX_STOP_FLUSH_CONT:
 	case IEEE80211_AMPDU_TX_STOP_CONT:
+		state = atomic_xchg(&sta_priv->ampdu[tid].state,
+				    WCN36XX_AMPDU_NONE);
+
+		/* Only an operational session was set up in firmware */
+		if (state == WCN36XX_AMPDU_OPERATIONAL)
+			wcn36xx_smd_del_ba(wcn, tid, 1, sta_index);
+		if (state != WCN36XX_AMPDU_NONE)
+			atomic_dec(&wcn->ba_sessions);
+
 		spin_lock_bh(&sta_priv->ampdu_lock);
-		sta_priv->ampdu_state[tid] = WCN36XX_AMPDU_NONE;
+		atomic_sub(sta_priv->tx_ba_buf[tid], &wcn->ba_buffers);
+		sta_priv->tx_ba_buf[tid] = 0;
 		spin_unlock_bh(&sta_priv->ampdu_lock);
 
 		ieee80211_stop_tx_ba_cb_irqsafe(vif, sta->addr, tid);
@@ -951,6 +1869,11 @@ static int wcn36xx_ampdu_action(struct ieee80211_hw *hw,
 	}
 
 	return 0;
+
+out_rx_put:
+	atomic_sub(win, &wcn->ba_buffers);
+	atomic_dec(&wcn->ba_sessions);
+	return -EINVAL;
 }
 
 static const struct ieee80211_ops wcn36xx_ops = {
@@ -961,19 +1884,30 @@ static const struct ieee80211_ops wcn36xx_ops = {
 #ifdef CONFIG_PM
 	.suspend		= wcn36xx_suspend,
 	.resume			= wcn36xx_resume,
+	.set_rekey_data		= wcn36xx_set_rekey_data,
 #endif
 	.config			= wcn36xx_config,
 	.prepare_multicast	= wcn36xx_prepare_multicast,
 	.configure_filter       = wcn36xx_configure_filter,
 	.tx			= wcn36xx_tx,
 	.set_key		= wcn36xx_set_key,
-	.sw_scan_start		= wcn36xx_sw_scan_start,
-	.sw_scan_complete	= wcn36xx_sw_scan_complete,
+	.hw_scan		= wcn36xx_hw_scan,
+	.cancel_hw_scan		= wcn36xx_cancel_hw_scan,
+	.sched_scan_start	= wcn36xx_sched_scan_start,
+	.sched_scan_stop	= wcn36xx_sched_scan_stop,
 	.bss_info_changed	= wcn36xx_bss_info_changed,
 	.set_rts_threshold	= wcn36xx_set_rts_threshold,
+	.conf_tx		= wcn36xx_conf_tx,
+#if IS_ENABLED(CONFIG_IPV6)
+	.ipv6_addr_change	= wcn36xx_ipv6_addr_change,
+#endif
 	.sta_add		= wcn36xx_sta_add,
 	.sta_remove		= wcn36xx_sta_remove,
 	.ampdu_action		= wcn36xx_ampdu_action,
+	.get_stats		= wcn36xx_get_stats,
+#if defined(CONFIG_MAC80211_DEBUGFS) && defined(CONFIG_WCN36XX_DEBUGFS)
+	.sta_add_debugfs	= wcn36xx_debugfs_sta_add,
+#endif
 };
 
 static int wcn36xx_init_ieee80211(struct wcn36xx *wcn)
@@ -990,6 +1924,7 @@ static int wcn36xx_init_ieee80211(struct wcn36xx *wcn)
 	wcn->hw->flags = IEEE80211_HW_SIGNAL_DBM |
 		IEEE80211_HW_HAS_RATE_CONTROL |
 		IEEE80211_HW_SUPPORTS_PS |
+		IEEE80211_HW_SUPPORTS_UAPSD |
 		IEEE80211_HW_CONNECTION_MONITOR |
 		IEEE80211_HW_AMPDU_AGGREGATION |
 		IEEE80211_HW_TIMING_BEACON_ONLY;
@@ -1007,10 +1942,33 @@ static int wcn36xx_init_ieee80211(struct wcn36xx *wcn)
 
 	wcn->hw->wiphy->flags |= WIPHY_FLAG_AP_PROBE_RESP_OFFLOAD;
 
+	/* Voice is trigger and delivery enabled when the AP offers U-APSD */
+	wcn->hw->uapsd_queues = IEEE80211_WMM_IE_STA_QOSINFO_AC_VO;
+	wcn->hw->uapsd_max_sp_len = IEEE80211_WMM_IE_STA_QOSINFO_SP_ALL;
+
+	wcn->hw->wiphy->max_scan_ssids = WCN36XX_HAL_SCAN_OFFLOAD_MAX_SSID;
+	wcn->hw->wiphy->max_scan_ie_len = WCN36XX_MAX_SCAN_IE_LEN;
+
+	/*
+	 * Firmware only reports PNO support once it runs, sched_scan_start
+	 * fails with -EOPNOTSUPP when it turns out to be missing.
+	 */
+	wcn->hw->wiphy->flags |= WIPHY_FLAG_SUPPORTS_SCHED_SCAN;
+	wcn->hw->wiphy->max_sched_scan_ssids = WCN36XX_HAL_PNO_MAX_SUPP_NETWORKS;
+	wcn->hw->wiphy->max_match_sets = WCN36XX_HAL_PNO_MAX_SUPP_NETWORKS;
+	wcn->hw->wiphy->max_sched_scan_ie_len = WCN36XX_MAX_SCHED_SCAN_IE_LEN;
+
 #ifdef CONFIG_PM
 	wcn->hw->wiphy->wowlan = &wowlan_support;
 #endif
 
+	ba_rx_win = clamp_t(unsigned int, ba_rx_win, 1,
+			    WCN36XX_AGGR_BUFFER_SIZE);
+	ba_tx_win = clamp_t(unsigned int, ba_tx_win, WCN36XX_BA_MIN_WIN,
+			    WCN36XX_AGGR_BUFFER_SIZE);
+	wcn->hw->max_rx_aggregation_subframes = ba_rx_win;
+	wcn->hw->max_tx_aggregation_subframes = ba_tx_win;
+
 	wcn->hw->max_listen_interval = 200;
 
 	wcn->hw->queues = 4;
@@ -1082,6 +2040,25 @@ static int wcn36xx_probe(struct platform_device *pdev)
 	wcn->ctrl_ops = pdev->dev.platform_data;
 
 	mutex_init(&wcn->hal_mutex);
+	mutex_init(&wcn->conf_mutex);
+	spin_lock_init(&wcn->hal_rsp_lock);
+	spin_lock_init(&wcn->hal_stats_lock);
+	INIT_WORK(&wcn->dxe_alloc_work, wcn36xx_dxe_alloc_work);
+	mutex_init(&wcn->scan_lock);
+	INIT_WORK(&wcn->scan_work, wcn36xx_hw_scan_worker);
+	INIT_WORK(&wcn->ns_offload_work, wcn36xx_ns_offload_work);
+	wcn36xx_tx_amsdu_init(wcn);
+	mutex_init(&wcn->mc_lock);
+	mutex_init(&wcn->pkt_filter_lock);
+	mutex_init(&wcn->stats_lock);
+	INIT_DELAYED_WORK(&wcn->stats_work, wcn36xx_fw_stats_work);
+	wcn36xx_pkt_filter_defaults(wcn);
+
+	wcn->scan_wq = alloc_ordered_workqueue("wcn36xx_scan", 0);
+	if (!wcn->scan_wq) {
+		ret = -ENOMEM;
+		goto out_wq;
+	}
 
 	if (!wcn->ctrl_ops->get_hw_mac(addr)) {
 		wcn36xx_info("mac address: %pM\n", addr);
@@ -1090,7 +2067,7 @@ static int wcn36xx_probe(struct platform_device *pdev)
 
 	ret = wcn36xx_platform_get_resources(wcn, pdev);
 	if (ret)
-		goto out_wq;
+		goto out_scan_wq;
 
 	wcn36xx_init_ieee80211(wcn);
 	ret = ieee80211_register_hw(wcn->hw);
@@ -1101,6 +2078,8 @@ static int wcn36xx_probe(struct platform_device *pdev)
 
 out_unmap:
 	iounmap(wcn->mmio);
+out_scan_wq:
+	destroy_workqueue(wcn->scan_wq);
 out_wq:
 	ieee80211_free_hw(hw);
 out_err:
@@ -1116,6 +2095,9 @@ static int wcn36xx_remove(struct platform_device *pdev)
 	mutex_destroy(&wcn->hal_mutex);
 
 	ieee80211_unregister_hw(hw);
+	destroy_workqueue(wcn->scan_wq);
+	/* Only after unregister, configure_filter may still replace it */
+	kfree(wcn->mc_list);
 	iounmap(wcn->mmio);
 	ieee80211_free_hw(hw);
 
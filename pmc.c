@@ -17,18 +17,78 @@
 
 #define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
 
+#include <linux/module.h>
+#include <linux/etherdevice.h>
 #include "wcn36xx.h"
 
-int wcn36xx_pmc_enter_bmps_state(struct wcn36xx *wcn,
-				 struct ieee80211_vif *vif)
+/* Governor tick period in ms */
+#define WCN36XX_PMC_TICK	100
+
+static unsigned int bmps_idle_ms = 500;
+module_param(bmps_idle_ms, uint, 0644);
+MODULE_PARM_DESC(bmps_idle_ms,
+		 "Inactivity in ms before the governor enters BMPS");
+
+static unsigned int bmps_exit_frames = 16;
+module_param(bmps_exit_frames, uint, 0644);
+MODULE_PARM_DESC(bmps_exit_frames,
+		 "Data frames per 100ms tick that make the governor leave BMPS, 0 never");
+
+static unsigned int uapsd_service_interval;
+module_param(uapsd_service_interval, uint, 0644);
+MODULE_PARM_DESC(uapsd_service_interval,
+		 "U-APSD service interval in ms for firmware generated triggers, 0 off");
+
+static void wcn36xx_pmc_account(struct wcn36xx_vif *vif_priv,
+				enum wcn36xx_power_state new_state)
+{
+	struct wcn36xx_pmc *pmc = &vif_priv->pmc;
+
+	pmc->time_ms[vif_priv->pw_state] +=
+		jiffies_to_msecs(jiffies - pmc->state_since);
+	pmc->state_since = jiffies;
+	vif_priv->pw_state = new_state;
+}
+
+u64 wcn36xx_pmc_time_in_state(struct wcn36xx_pmc *pmc,
+			      enum wcn36xx_power_state state)
+{
+	struct wcn36xx_vif *vif_priv = container_of(pmc, struct wcn36xx_vif,
+						    pmc);
+	u64 time_ms = pmc->time_ms[state];
+
+	if (vif_priv->pw_state == state)
+		time_ms += jiffies_to_msecs(jiffies - pmc->state_since);
+	return time_ms;
+}
+
+static int __wcn36xx_pmc_enter_bmps_state(struct wcn36xx *wcn,
+					  struct ieee80211_vif *vif)
 {
 	int ret = 0;
 	struct wcn36xx_vif *vif_priv = wcn36xx_vif_to_priv(vif);
+	struct wcn36xx_pmc *pmc = &vif_priv->pmc;
+	ktime_t start = ktime_get();
+	u32 usecs;
+
+	if (vif_priv->pw_state == WCN36XX_BMPS)
+		return 0;
+
 	/* TODO: Make sure the TX chain clean */
 	ret = wcn36xx_smd_enter_bmps(wcn, vif);
 	if (!ret) {
 		wcn36xx_dbg(WCN36XX_DBG_PMC, "Entered BMPS\n");
-		vif_priv->pw_state = WCN36XX_BMPS;
+		usecs = ktime_us_delta(ktime_get(), start);
+		pmc->enter++;
+		pmc->enter_lat_us += usecs;
+		pmc->enter_lat_max_us = max(pmc->enter_lat_max_us, usecs);
+		wcn36xx_pmc_account(vif_priv, WCN36XX_BMPS);
+
+		/* U-APSD rides on top of BMPS */
+		if (vif_priv->uapsd_acs && !wcn36xx_smd_enter_uapsd(wcn, vif)) {
+			vif_priv->uapsd_active = true;
+			pmc->uapsd++;
+		}
 	} else {
 		/*
 		 * One of the reasons why HW will not enter BMPS is because
@@ -36,24 +96,231 @@ int wcn36xx_pmc_enter_bmps_state(struct wcn36xx *wcn,
 		 * received just after auth complete
 		 */
 		wcn36xx_err("Can not enter BMPS!\n");
+		pmc->fail++;
 	}
 	return ret;
 }
 
-int wcn36xx_pmc_exit_bmps_state(struct wcn36xx *wcn,
-				struct ieee80211_vif *vif)
+static int __wcn36xx_pmc_exit_bmps_state(struct wcn36xx *wcn,
+					 struct ieee80211_vif *vif)
 {
 	struct wcn36xx_vif *vif_priv = wcn36xx_vif_to_priv(vif);
+	struct wcn36xx_pmc *pmc = &vif_priv->pmc;
+	ktime_t start = ktime_get();
+	u32 usecs;
 
 	if (WCN36XX_BMPS != vif_priv->pw_state) {
 		wcn36xx_err("Not in BMPS mode, no need to exit from BMPS mode!\n");
 		return -EINVAL;
 	}
-	wcn36xx_smd_exit_bmps(wcn, vif);
-	vif_priv->pw_state = WCN36XX_FULL_POWER;
+	if (vif_priv->uapsd_active) {
+		wcn36xx_smd_exit_uapsd(wcn, vif);
+		vif_priv->uapsd_active = false;
+	}
+	if (wcn36xx_smd_exit_bmps(wcn, vif))
+		pmc->fail++;
+
+	usecs = ktime_us_delta(ktime_get(), start);
+	pmc->exit++;
+	pmc->exit_lat_us += usecs;
+	pmc->exit_lat_max_us = max(pmc->exit_lat_max_us, usecs);
+	pmc->idle_ms = 0;
+	wcn36xx_pmc_account(vif_priv, WCN36XX_FULL_POWER);
 	return 0;
 }
 
+int wcn36xx_pmc_enter_bmps_state(struct wcn36xx *wcn,
+				 struct ieee80211_vif *vif)
+{
+	struct wcn36xx_vif *vif_priv = wcn36xx_vif_to_priv(vif);
+	int ret;
+
+	mutex_lock(&vif_priv->pmc.lock);
+	ret = __wcn36xx_pmc_enter_bmps_state(wcn, vif);
+	mutex_unlock(&vif_priv->pmc.lock);
+
+	return ret;
+}
+
+int wcn36xx_pmc_exit_bmps_state(struct wcn36xx *wcn,
+				struct ieee80211_vif *vif)
+{
+	struct wcn36xx_vif *vif_priv = wcn36xx_vif_to_priv(vif);
+	int ret;
+
+	mutex_lock(&vif_priv->pmc.lock);
+	ret = __wcn36xx_pmc_exit_bmps_state(wcn, vif);
+	mutex_unlock(&vif_priv->pmc.lock);
+
+	return ret;
+}
+
+/*
+ * BMPS is entered only after bmps_idle_ms without data and left only
+ * when a tick sees at least bmps_exit_frames, so sparse traffic is served
+ * by the SMSM wake in BMPS and bursts get full power without flapping.
+ */
+static void wcn36xx_pmc_work(struct work_struct *work)
+{
+	struct wcn36xx_pmc *pmc = container_of(to_delayed_work(work),
+					       struct wcn36xx_pmc, work);
+	struct wcn36xx_vif *vif_priv = container_of(pmc, struct wcn36xx_vif,
+						    pmc);
+	struct ieee80211_vif *vif = wcn36xx_priv_to_vif(vif_priv);
+	struct wcn36xx *wcn = pmc->wcn;
+	unsigned int frames;
+
+	mutex_lock(&pmc->lock);
+	if (!pmc->allowed)
+		goto out;
+
+	frames = atomic_xchg(&pmc->activity, 0);
+	if (vif_priv->pw_state == WCN36XX_FULL_POWER) {
+		if (frames)
+			pmc->idle_ms = 0;
+		else
+			pmc->idle_ms += WCN36XX_PMC_TICK;
+
+		if (pmc->idle_ms >= bmps_idle_ms &&
+		    __wcn36xx_pmc_enter_bmps_state(wcn, vif))
+			pmc->idle_ms = 0;
+	} else if (bmps_exit_frames && frames >= bmps_exit_frames) {
+		wcn36xx_dbg(WCN36XX_DBG_PMC, "%u frames in BMPS, waking up\n",
+			    frames);
+		__wcn36xx_pmc_exit_bmps_state(wcn, vif);
+	}
+
+	ieee80211_queue_delayed_work(wcn->hw, &pmc->work,
+				     msecs_to_jiffies(WCN36XX_PMC_TICK));
+out:
+	mutex_unlock(&pmc->lock);
+}
+
+void wcn36xx_pmc_set_ps(struct wcn36xx *wcn, struct ieee80211_vif *vif,
+			bool enable)
+{
+	struct wcn36xx_vif *vif_priv = wcn36xx_vif_to_priv(vif);
+	struct wcn36xx_pmc *pmc = &vif_priv->pmc;
+
+	mutex_lock(&pmc->lock);
+	pmc->allowed = enable;
+	pmc->idle_ms = 0;
+	atomic_set(&pmc->activity, 0);
+	if (!enable && vif_priv->pw_state == WCN36XX_BMPS)
+		__wcn36xx_pmc_exit_bmps_state(wcn, vif);
+	mutex_unlock(&pmc->lock);
+
+	if (enable)
+		ieee80211_queue_delayed_work(wcn->hw, &pmc->work,
+					     msecs_to_jiffies(WCN36XX_PMC_TICK));
+	else
+		cancel_delayed_work_sync(&pmc->work);
+}
+
+void wcn36xx_pmc_rx_activity(struct wcn36xx *wcn, struct ieee80211_hdr *hdr)
+{
+	struct wcn36xx_vif *vif_priv;
+	int ac = IEEE80211_AC_BE;
+
+	if (ieee80211_is_data_qos(hdr->frame_control))
+		ac = wcn36xx_up_to_ac(*ieee80211_get_qos_ctl(hdr));
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(vif_priv, &wcn->vif_list, list) {
+		if (ether_addr_equal(wcn36xx_priv_to_vif(vif_priv)->addr,
+				     hdr->addr1)) {
+			/* Delivery enabled ACs do not need full power */
+			if (!(vif_priv->uapsd_active &&
+			      vif_priv->uapsd_acs & BIT(ac)))
+				atomic_inc(&vif_priv->pmc.activity);
+			break;
+		}
+	}
+	rcu_read_unlock();
+}
+
+static void wcn36xx_pmc_uapsd_ac_params(struct wcn36xx *wcn,
+					struct wcn36xx_vif *vif_priv,
+					u8 sta_index)
+{
+	int ac;
+
+	if (!uapsd_service_interval)
+		return;
+
+	for (ac = 0; ac < IEEE80211_NUM_ACS; ac++)
+		if (vif_priv->uapsd_acs & BIT(ac))
+			wcn36xx_smd_set_uapsd_ac_params(wcn, sta_index, ac,
+							uapsd_service_interval);
+}
+
+void wcn36xx_pmc_set_uapsd(struct wcn36xx *wcn, struct ieee80211_vif *vif,
+			   u8 acs)
+{
+	struct wcn36xx_vif *vif_priv = wcn36xx_vif_to_priv(vif);
+	struct wcn36xx_pmc *pmc = &vif_priv->pmc;
+	struct ieee80211_sta *sta;
+	int sta_index = -1;
+
+	mutex_lock(&pmc->lock);
+	if (vif_priv->uapsd_active) {
+		wcn36xx_smd_exit_uapsd(wcn, vif);
+		vif_priv->uapsd_active = false;
+	}
+	vif_priv->uapsd_acs = acs;
+
+	if (NL80211_IFTYPE_STATION == vif->type && vif_priv->sta_assoc) {
+		rcu_read_lock();
+		sta = ieee80211_find_sta(vif, vif->bss_conf.bssid);
+		if (sta)
+			sta_index = wcn36xx_sta_to_priv(sta)->sta_index;
+		rcu_read_unlock();
+	}
+	if (sta_index >= 0) {
+		wcn36xx_smd_update_uapsd_params(wcn, vif, sta_index);
+		wcn36xx_pmc_uapsd_ac_params(wcn, vif_priv, sta_index);
+	}
+
+	if (vif_priv->pw_state == WCN36XX_BMPS && acs &&
+	    !wcn36xx_smd_enter_uapsd(wcn, vif)) {
+		vif_priv->uapsd_active = true;
+		pmc->uapsd++;
+	}
+	mutex_unlock(&pmc->lock);
+}
+
+void wcn36xx_pmc_uapsd_assoc(struct wcn36xx *wcn, struct ieee80211_vif *vif,
+			     u8 sta_index)
+{
+	struct wcn36xx_vif *vif_priv = wcn36xx_vif_to_priv(vif);
+
+	/* The AC mask itself went to the firmware with config_sta */
+	mutex_lock(&vif_priv->pmc.lock);
+	wcn36xx_pmc_uapsd_ac_params(wcn, vif_priv, sta_index);
+	mutex_unlock(&vif_priv->pmc.lock);
+}
+
+void wcn36xx_pmc_init(struct wcn36xx *wcn, struct ieee80211_vif *vif)
+{
+	struct wcn36xx_pmc *pmc = &wcn36xx_vif_to_priv(vif)->pmc;
+
+	memset(pmc, 0, sizeof(*pmc));
+	pmc->wcn = wcn;
+	pmc->state_since = jiffies;
+	mutex_init(&pmc->lock);
+	INIT_DELAYED_WORK(&pmc->work, wcn36xx_pmc_work);
+}
+
+void wcn36xx_pmc_deinit(struct wcn36xx *wcn, struct ieee80211_vif *vif)
+{
+	struct wcn36xx_pmc *pmc = &wcn36xx_vif_to_priv(vif)->pmc;
+
+	mutex_lock(&pmc->lock);
+	pmc->allowed = false;
+	mutex_unlock(&pmc->lock);
+	cancel_delayed_work_sync(&pmc->work);
+}
+
 int wcn36xx_enable_keep_alive_null_packet(struct wcn36xx *wcn,
 					  struct ieee80211_vif *vif)
 {
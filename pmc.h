@@ -22,7 +22,48 @@ struct wcn36xx;
 
 enum wcn36xx_power_state {
 	WCN36XX_FULL_POWER,
-	WCN36XX_BMPS
+	WCN36XX_BMPS,
+	WCN36XX_POWER_STATE_NUM
+};
+
+/**
+ * struct wcn36xx_pmc - per vif BMPS governor
+ *
+ * @wcn: owning device, for the governor work.
+ * @lock: serialises BMPS transitions and the fields below.
+ * @work: periodic governor tick, runs while @allowed.
+ * @allowed: mac80211 enabled power save for the vif.
+ * @activity: data frames since the last tick, updated from TX/RX paths.
+ * @idle_ms: time without activity accumulated at full power.
+ * @state_since: jiffies of the last transition.
+ * @time_ms: total time spent in each power state.
+ * @enter: number of BMPS entries.
+ * @exit: number of BMPS exits.
+ * @fail: number of failed transitions.
+ * @uapsd: number of U-APSD entries.
+ * @enter_lat_us: total BMPS entry latency.
+ * @exit_lat_us: total BMPS exit latency.
+ * @enter_lat_max_us: worst BMPS entry latency.
+ * @exit_lat_max_us: worst BMPS exit latency.
+ */
+struct wcn36xx_pmc {
+	struct wcn36xx *wcn;
+	struct mutex lock;
+	struct delayed_work work;
+	bool allowed;
+	atomic_t activity;
+	unsigned int idle_ms;
+
+	unsigned long state_since;
+	u64 time_ms[WCN36XX_POWER_STATE_NUM];
+	u32 enter;
+	u32 exit;
+	u32 fail;
+	u32 uapsd;
+	u64 enter_lat_us;
+	u64 exit_lat_us;
+	u32 enter_lat_max_us;
+	u32 exit_lat_max_us;
 };
 
 int wcn36xx_pmc_enter_bmps_state(struct wcn36xx *wcn,
@@ -31,4 +72,15 @@ int wcn36xx_pmc_exit_bmps_state(struct wcn36xx *wcn,
 				struct ieee80211_vif *vif);
 int wcn36xx_enable_keep_alive_null_packet(struct wcn36xx *wcn,
 					  struct ieee80211_vif *vif);
+void wcn36xx_pmc_init(struct wcn36xx *wcn, struct ieee80211_vif *vif);
+void wcn36xx_pmc_deinit(struct wcn36xx *wcn, struct ieee80211_vif *vif);
+void wcn36xx_pmc_set_ps(struct wcn36xx *wcn, struct ieee80211_vif *vif,
+			bool enable);
+void wcn36xx_pmc_rx_activity(struct wcn36xx *wcn, struct ieee80211_hdr *hdr);
+void wcn36xx_pmc_set_uapsd(struct wcn36xx *wcn, struct ieee80211_vif *vif,
+			   u8 acs);
+void wcn36xx_pmc_uapsd_assoc(struct wcn36xx *wcn, struct ieee80211_vif *vif,
+			     u8 sta_index);
+u64 wcn36xx_pmc_time_in_state(struct wcn36xx_pmc *pmc,
+			      enum wcn36xx_power_state state);
 #endif	/* _WCN36XX_PMC_H_ */
@@ -20,8 +20,18 @@
 #include <linux/etherdevice.h>
 #include <linux/firmware.h>
 #include <linux/bitops.h>
+#include <linux/module.h>
+#include <net/addrconf.h>
 #include "smd.h"
 
+static unsigned int hal_timeout_floor = WCN36XX_HAL_TIMEOUT_FLOOR;
+module_param(hal_timeout_floor, uint, 0644);
+MODULE_PARM_DESC(hal_timeout_floor, "Lower bound of adaptive HAL timeouts in ms");
+
+static unsigned int hal_timeout_ceil = HAL_MSG_TIMEOUT;
+module_param(hal_timeout_ceil, uint, 0644);
+MODULE_PARM_DESC(hal_timeout_ceil, "Upper bound of adaptive HAL timeouts in ms");
+
 struct wcn36xx_cfg_val {
 	u32 cfg_id;
 	u32 value;
@@ -59,7 +69,7 @@ static struct wcn36xx_cfg_val wcn36xx_cfg_vals[] = {
 	WCN36XX_CFG_VAL(FIXED_RATE_MULTICAST_24GHZ, 1),
 	WCN36XX_CFG_VAL(FIXED_RATE_MULTICAST_5GHZ, 5),
 	WCN36XX_CFG_VAL(DEFAULT_RATE_INDEX_5GHZ, 5),
-	WCN36XX_CFG_VAL(MAX_BA_SESSIONS, 40),
+	WCN36XX_CFG_VAL(MAX_BA_SESSIONS, WCN36XX_MAX_BA_SESSIONS),
 	WCN36XX_CFG_VAL(PS_DATA_INACTIVITY_TIMEOUT, 200),
 	WCN36XX_CFG_VAL(PS_ENABLE_BCN_FILTER, 1),
 	WCN36XX_CFG_VAL(PS_ENABLE_RSSI_MONITOR, 1),
@@ -68,7 +78,7 @@ static struct wcn36xx_cfg_val wcn36xx_cfg_vals[] = {
 	WCN36XX_CFG_VAL(CFP_MAX_DURATION, 30000),
 	WCN36XX_CFG_VAL(FRAME_TRANS_ENABLED, 0),
 	WCN36XX_CFG_VAL(BA_THRESHOLD_HIGH, 128),
-	WCN36XX_CFG_VAL(MAX_BA_BUFFERS, 2560),
+	WCN36XX_CFG_VAL(MAX_BA_BUFFERS, WCN36XX_MAX_BA_BUFFERS),
 	WCN36XX_CFG_VAL(DYNAMIC_PS_POLL_VALUE, 0),
 	WCN36XX_CFG_VAL(TX_PWR_CTRL_ENABLE, 1),
 	WCN36XX_CFG_VAL(ENABLE_CLOSE_LOOP, 1),
@@ -119,6 +129,19 @@ static inline u8 is_cap_supported(unsigned long caps, unsigned long flag)
 {
 	return caps & flag ? 1 : 0;
 }
+
+static void wcn36xx_smd_fill_edca(struct wcn36xx_vif *vif_priv,
+				  struct wcn36xx_hal_edca_param_record *acbe,
+				  struct wcn36xx_hal_edca_param_record *acbk,
+				  struct wcn36xx_hal_edca_param_record *acvi,
+				  struct wcn36xx_hal_edca_param_record *acvo)
+{
+	*acbe = vif_priv->edca[IEEE80211_AC_BE];
+	*acbk = vif_priv->edca[IEEE80211_AC_BK];
+	*acvi = vif_priv->edca[IEEE80211_AC_VI];
+	*acvo = vif_priv->edca[IEEE80211_AC_VO];
+}
+
 static void wcn36xx_smd_set_bss_ht_params(struct ieee80211_vif *vif,
 		struct ieee80211_sta *sta,
 		struct wcn36xx_hal_config_bss_params *bss_params)
@@ -187,6 +210,22 @@ static void wcn36xx_smd_set_sta_default_ht_params(
 	sta_params->dsss_cck_mode_40mhz = 1;
 }
 
+/* mac80211 AC bitmap to the per AC U-APSD flags of the HAL */
+static u8 wcn36xx_smd_uapsd_mask(u8 acs)
+{
+	u8 mask = 0;
+
+	if (acs & BIT(IEEE80211_AC_VO))
+		mask |= BIT(0);
+	if (acs & BIT(IEEE80211_AC_VI))
+		mask |= BIT(1);
+	if (acs & BIT(IEEE80211_AC_BK))
+		mask |= BIT(2);
+	if (acs & BIT(IEEE80211_AC_BE))
+		mask |= BIT(3);
+	return mask;
+}
+
 static void wcn36xx_smd_set_sta_params(struct wcn36xx *wcn,
 		struct ieee80211_vif *vif,
 		struct ieee80211_sta *sta,
@@ -238,6 +277,11 @@ static void wcn36xx_smd_set_sta_params(struct wcn36xx *wcn,
 			memcpy(&sta_params->mac, sta->addr, ETH_ALEN);
 		sta_params->wmm_enabled = sta->wme;
 		sta_params->max_sp_len = sta->max_sp;
+		if (NL80211_IFTYPE_STATION == vif->type && sta->wme) {
+			sta_params->uapsd =
+				wcn36xx_smd_uapsd_mask(vif_priv->uapsd_acs);
+			sta_params->max_sp_len = wcn->hw->uapsd_max_sp_len;
+		}
 		sta_params->aid = sta_priv->aid;
 		wcn36xx_smd_set_sta_ht_params(sta, sta_params);
 		memcpy(&sta_params->supported_rates, &sta_priv->supported_rates,
@@ -248,29 +292,170 @@ static void wcn36xx_smd_set_sta_params(struct wcn36xx *wcn,
 	}
 }
 
+static void wcn36xx_smd_stats_account(struct wcn36xx *wcn,
+				 enum wcn36xx_hal_host_msg_type msg_type,
+				 size_t len)
+{
+	struct wcn36xx_hal_msg_stats *stats;
+
+	if (msg_type >= WCN36XX_HAL_MSG_NUM)
+		return;
+
+	stats = &wcn->hal_stats[msg_type];
+	spin_lock(&wcn->hal_stats_lock);
+	stats->count++;
+	stats->bytes += len;
+	spin_unlock(&wcn->hal_stats_lock);
+}
+
+static const struct wcn36xx_hal_msg_desc *
+wcn36xx_smd_msg_desc(enum wcn36xx_hal_host_msg_type msg_type);
+
+static int wcn36xx_smd_lat_bucket(u32 usecs)
+{
+	int bucket = fls(usecs / WCN36XX_HAL_LAT_BASE_US);
+
+	return min(bucket, WCN36XX_HAL_LAT_BUCKETS - 1);
+}
+
+static void wcn36xx_smd_stats_latency(struct wcn36xx *wcn,
+				      enum wcn36xx_hal_host_msg_type msg_type,
+				      u32 usecs)
+{
+	struct wcn36xx_hal_msg_stats *stats;
+
+	if (msg_type >= WCN36XX_HAL_MSG_NUM)
+		return;
+
+	stats = &wcn->hal_stats[msg_type];
+	spin_lock(&wcn->hal_stats_lock);
+	if (!stats->completed || usecs < stats->lat_min)
+		stats->lat_min = usecs;
+	if (usecs > stats->lat_max)
+		stats->lat_max = usecs;
+	stats->lat_total += usecs;
+	stats->lat_hist[wcn36xx_smd_lat_bucket(usecs)]++;
+	stats->completed++;
+	spin_unlock(&wcn->hal_stats_lock);
+}
+
+/* Consistent copy of the statistics of one message type */
+void wcn36xx_smd_stats_get(struct wcn36xx *wcn,
+			   enum wcn36xx_hal_host_msg_type msg_type,
+			   struct wcn36xx_hal_msg_stats *stats)
+{
+	spin_lock(&wcn->hal_stats_lock);
+	*stats = wcn->hal_stats[msg_type];
+	spin_unlock(&wcn->hal_stats_lock);
+}
+
+void wcn36xx_smd_stats_reset(struct wcn36xx *wcn)
+{
+	spin_lock(&wcn->hal_stats_lock);
+	memset(wcn->hal_stats, 0, sizeof(wcn->hal_stats));
+	spin_unlock(&wcn->hal_stats_lock);
+}
+
+/*
+ * Returns the upper bound in usecs of the histogram bucket holding the
+ * given percentile, or 0 if nothing was measured yet. The last bucket is
+ * open ended so its lower bound is returned instead.
+ */
+u32 wcn36xx_smd_lat_percentile(struct wcn36xx_hal_msg_stats *stats, int pct)
+{
+	u32 target, sum = 0;
+	int i;
+
+	if (!stats->completed)
+		return 0;
+
+	target = DIV_ROUND_UP(stats->completed * pct, 100);
+	for (i = 0; i < WCN36XX_HAL_LAT_BUCKETS - 1; i++) {
+		sum += stats->lat_hist[i];
+		if (sum >= target)
+			return WCN36XX_HAL_LAT_BASE_US << i;
+	}
+	return WCN36XX_HAL_LAT_BASE_US << (WCN36XX_HAL_LAT_BUCKETS - 2);
+}
+
+/*
+ * Timeout in ms for the given request. Until enough responses have been
+ * seen the ceiling is used, afterwards a margin on top of the observed
+ * p99 latency bounded by the floor and the ceiling. Requests with a known
+ * slow firmware path carry their own floor in the dispatch table.
+ */
+unsigned int wcn36xx_smd_timeout(struct wcn36xx *wcn,
+				 enum wcn36xx_hal_host_msg_type msg_type)
+{
+	const struct wcn36xx_hal_msg_desc *desc = wcn36xx_smd_msg_desc(msg_type);
+	struct wcn36xx_hal_msg_stats stats;
+	unsigned int floor = hal_timeout_floor;
+	unsigned int ceil = hal_timeout_ceil;
+	unsigned int timeout;
+
+	if (desc)
+		floor = max(floor, desc->timeout_floor);
+	ceil = max(ceil, floor);
+
+	if (msg_type >= WCN36XX_HAL_MSG_NUM)
+		return ceil;
+
+	wcn36xx_smd_stats_get(wcn, msg_type, &stats);
+	if (stats.completed < WCN36XX_HAL_TIMEOUT_MIN_SAMPLES)
+		return ceil;
+
+	timeout = DIV_ROUND_UP(wcn36xx_smd_lat_percentile(&stats, 99) *
+			       WCN36XX_HAL_TIMEOUT_MARGIN, USEC_PER_MSEC);
+
+	return clamp(timeout, floor, ceil);
+}
+
 static int wcn36xx_smd_send_and_wait(struct wcn36xx *wcn, size_t len)
 {
+	struct wcn36xx_hal_msg_header *hdr =
+		(struct wcn36xx_hal_msg_header *)wcn->hal_buf;
+	enum wcn36xx_hal_host_msg_type msg_type = hdr->msg_type;
+	unsigned int timeout = wcn36xx_smd_timeout(wcn, msg_type);
 	int ret = 0;
-	unsigned long start;
+	ktime_t start;
+	u32 usecs;
 	wcn36xx_dbg_dump(WCN36XX_DBG_SMD_DUMP, "HAL >>> ", wcn->hal_buf, len);
 
 	init_completion(&wcn->hal_rsp_compl);
-	start = jiffies;
+	wcn36xx_smd_stats_account(wcn, msg_type, len);
+
+	spin_lock(&wcn->hal_rsp_lock);
+	wcn->hal_req_type = msg_type;
+	wcn->hal_req_pending = true;
+	spin_unlock(&wcn->hal_rsp_lock);
+
+	start = ktime_get();
 	ret = wcn->ctrl_ops->tx(wcn->hal_buf, len);
 	if (ret) {
 		wcn36xx_err("HAL TX failed\n");
 		goto out;
 	}
 	if (wait_for_completion_timeout(&wcn->hal_rsp_compl,
-		msecs_to_jiffies(HAL_MSG_TIMEOUT)) <= 0) {
-		wcn36xx_err("Timeout! No SMD response in %dms\n",
-			    HAL_MSG_TIMEOUT);
+		msecs_to_jiffies(timeout)) <= 0) {
+		wcn36xx_err("Timeout! No SMD response to %s in %ums\n",
+			    wcn36xx_smd_msg_name(msg_type), timeout);
+		if (msg_type < WCN36XX_HAL_MSG_NUM) {
+			spin_lock(&wcn->hal_stats_lock);
+			wcn->hal_stats[msg_type].timeouts++;
+			spin_unlock(&wcn->hal_stats_lock);
+		}
 		ret = -ETIME;
 		goto out;
 	}
-	wcn36xx_dbg(WCN36XX_DBG_SMD, "SMD command completed in %dms\n",
-		    jiffies_to_msecs(jiffies - start));
+	usecs = ktime_us_delta(ktime_get(), start);
+	wcn36xx_smd_stats_latency(wcn, msg_type, usecs);
+	wcn36xx_dbg(WCN36XX_DBG_SMD, "SMD command %s completed in %uus\n",
+		    wcn36xx_smd_msg_name(msg_type), usecs);
 out:
+	/* A response arriving after this point is stale and gets dropped */
+	spin_lock(&wcn->hal_rsp_lock);
+	wcn->hal_req_pending = false;
+	spin_unlock(&wcn->hal_rsp_lock);
 	return ret;
 }
 
@@ -292,6 +477,21 @@ static void init_hal_msg(struct wcn36xx_hal_msg_header *hdr,
 		msg_body.header.len = sizeof(msg_body);			\
 	} while (0)							\
 
+/*
+ * Typed in-place builder. Points msg_body at hal_buf + offset and
+ * initialises it like INIT_HAL_MSG, so large messages need neither a
+ * stack copy nor PREPARE_HAL_BUF. Must be called with hal_mutex held.
+ */
+#define INIT_HAL_BUF_MSG_AT(wcn, msg_body, type, offset)		\
+	do {								\
+		BUILD_BUG_ON(sizeof(*(msg_body)) > WCN36XX_HAL_BUF_SIZE); \
+		(msg_body) = (void *)((wcn)->hal_buf + (offset));	\
+		INIT_HAL_MSG((*(msg_body)), type);			\
+	} while (0)
+
+#define INIT_HAL_BUF_MSG(wcn, msg_body, type)				\
+	INIT_HAL_BUF_MSG_AT(wcn, msg_body, type, 0)
+
 #define PREPARE_HAL_BUF(send_buf, msg_body) \
 	do {							\
 		memset(send_buf, 0, msg_body.header.len);	\
@@ -318,10 +518,11 @@ static int wcn36xx_smd_rsp_status_check(void *buf, size_t len)
 int wcn36xx_smd_load_nv(struct wcn36xx *wcn)
 {
 	struct nv_data *nv_d;
-	struct wcn36xx_hal_nv_img_download_req_msg msg_body;
-	int fw_bytes_left;
+	struct wcn36xx_hal_nv_img_download_req_msg *msg_body;
+	size_t fw_bytes_left;
+	ktime_t start;
 	int ret;
-	u16 fm_offset = 0;
+	u32 fm_offset = 0;
 
 	if (!wcn->nv) {
 		ret = request_firmware(&wcn->nv, WLAN_NV_FILE, wcn->dev);
@@ -333,37 +534,32 @@ int wcn36xx_smd_load_nv(struct wcn36xx *wcn)
 	}
 
 	nv_d = (struct nv_data *)wcn->nv->data;
-	INIT_HAL_MSG(msg_body, WCN36XX_HAL_DOWNLOAD_NV_REQ);
+	start = ktime_get();
 
-	msg_body.header.len += WCN36XX_NV_FRAGMENT_SIZE;
-
-	msg_body.frag_number = 0;
 	/* hal_buf must be protected with  mutex */
 	mutex_lock(&wcn->hal_mutex);
 
 	do {
 		fw_bytes_left = wcn->nv->size - fm_offset - 4;
+
+		/* The response overwrites hal_buf, so rebuild every round */
+		INIT_HAL_BUF_MSG(wcn, msg_body, WCN36XX_HAL_DOWNLOAD_NV_REQ);
+		msg_body->frag_number = fm_offset / WCN36XX_NV_FRAGMENT_SIZE;
 		if (fw_bytes_left > WCN36XX_NV_FRAGMENT_SIZE) {
-			msg_body.last_fragment = 0;
-			msg_body.nv_img_buffer_size = WCN36XX_NV_FRAGMENT_SIZE;
+			msg_body->last_fragment = 0;
+			msg_body->nv_img_buffer_size = WCN36XX_NV_FRAGMENT_SIZE;
 		} else {
-			msg_body.last_fragment = 1;
-			msg_body.nv_img_buffer_size = fw_bytes_left;
-
-			/* Do not forget update general message len */
-			msg_body.header.len = sizeof(msg_body) + fw_bytes_left;
-
+			msg_body->last_fragment = 1;
+			msg_body->nv_img_buffer_size = fw_bytes_left;
 		}
-
-		/* Add load NV request message header */
-		memcpy(wcn->hal_buf, &msg_body,	sizeof(msg_body));
+		msg_body->header.len += msg_body->nv_img_buffer_size;
 
 		/* Add NV body itself */
-		memcpy(wcn->hal_buf + sizeof(msg_body),
+		memcpy(wcn->hal_buf + sizeof(*msg_body),
 		       &nv_d->table + fm_offset,
-		       msg_body.nv_img_buffer_size);
+		       msg_body->nv_img_buffer_size);
 
-		ret = wcn36xx_smd_send_and_wait(wcn, msg_body.header.len);
+		ret = wcn36xx_smd_send_and_wait(wcn, msg_body->header.len);
 		if (ret)
 			goto out_unlock;
 		ret = wcn36xx_smd_rsp_status_check(wcn->hal_buf,
@@ -373,10 +569,12 @@ int wcn36xx_smd_load_nv(struct wcn36xx *wcn)
 				    ret);
 			goto out_unlock;
 		}
-		msg_body.frag_number++;
 		fm_offset += WCN36XX_NV_FRAGMENT_SIZE;
 
-	} while (msg_body.last_fragment != 1);
+	} while (fm_offset < wcn->nv->size - 4);
+
+	wcn36xx_dbg(WCN36XX_DBG_HAL, "NV download of %zu bytes took %lldus\n",
+		    wcn->nv->size - 4, ktime_us_delta(ktime_get(), start));
 
 out_unlock:
 	mutex_unlock(&wcn->hal_mutex);
@@ -495,19 +693,31 @@ out:
 	return ret;
 }
 
-int wcn36xx_smd_init_scan(struct wcn36xx *wcn, enum wcn36xx_hal_sys_mode mode)
+int wcn36xx_smd_init_scan(struct wcn36xx *wcn, enum wcn36xx_hal_sys_mode mode,
+			  struct ieee80211_vif *vif)
 {
 	struct wcn36xx_hal_init_scan_req_msg msg_body;
+	struct wcn36xx_vif *vif_priv;
 	int ret = 0;
 
 	mutex_lock(&wcn->hal_mutex);
 	INIT_HAL_MSG(msg_body, WCN36XX_HAL_INIT_SCAN_REQ);
 
 	msg_body.mode = mode;
+	if (vif) {
+		/* Tell the BSS we are going to power save with a null frame */
+		vif_priv = wcn36xx_vif_to_priv(vif);
+		memcpy(msg_body.bssid, vif->bss_conf.bssid, ETH_ALEN);
+		msg_body.notify = 1;
+		msg_body.frame_type = 2;
+		msg_body.scan_entry.bss_index[0] = vif_priv->bss_index;
+		msg_body.scan_entry.active_bss_count = 1;
+	}
 
 	PREPARE_HAL_BUF(wcn->hal_buf, msg_body);
 
-	wcn36xx_dbg(WCN36XX_DBG_HAL, "hal init scan mode %d\n", msg_body.mode);
+	wcn36xx_dbg(WCN36XX_DBG_HAL, "hal init scan mode %d notify %d\n",
+		    msg_body.mode, msg_body.notify);
 
 	ret = wcn36xx_smd_send_and_wait(wcn, msg_body.header.len);
 	if (ret) {
@@ -524,7 +734,7 @@ out:
 	return ret;
 }
 
-int wcn36xx_smd_start_scan(struct wcn36xx *wcn)
+int wcn36xx_smd_start_scan(struct wcn36xx *wcn, u8 scan_channel)
 {
 	struct wcn36xx_hal_start_scan_req_msg msg_body;
 	int ret = 0;
@@ -532,7 +742,7 @@ int wcn36xx_smd_start_scan(struct wcn36xx *wcn)
 	mutex_lock(&wcn->hal_mutex);
 	INIT_HAL_MSG(msg_body, WCN36XX_HAL_START_SCAN_REQ);
 
-	msg_body.scan_channel = WCN36XX_HW_CHANNEL(wcn);
+	msg_body.scan_channel = scan_channel;
 
 	PREPARE_HAL_BUF(wcn->hal_buf, msg_body);
 
@@ -554,7 +764,7 @@ out:
 	return ret;
 }
 
-int wcn36xx_smd_end_scan(struct wcn36xx *wcn)
+int wcn36xx_smd_end_scan(struct wcn36xx *wcn, u8 scan_channel)
 {
 	struct wcn36xx_hal_end_scan_req_msg msg_body;
 	int ret = 0;
@@ -562,7 +772,7 @@ int wcn36xx_smd_end_scan(struct wcn36xx *wcn)
 	mutex_lock(&wcn->hal_mutex);
 	INIT_HAL_MSG(msg_body, WCN36XX_HAL_END_SCAN_REQ);
 
-	msg_body.scan_channel = WCN36XX_HW_CHANNEL(wcn);
+	msg_body.scan_channel = scan_channel;
 
 	PREPARE_HAL_BUF(wcn->hal_buf, msg_body);
 
@@ -585,20 +795,33 @@ out:
 }
 
 int wcn36xx_smd_finish_scan(struct wcn36xx *wcn,
-			    enum wcn36xx_hal_sys_mode mode)
+			    enum wcn36xx_hal_sys_mode mode,
+			    struct ieee80211_vif *vif)
 {
 	struct wcn36xx_hal_finish_scan_req_msg msg_body;
+	struct wcn36xx_vif *vif_priv;
 	int ret = 0;
 
 	mutex_lock(&wcn->hal_mutex);
 	INIT_HAL_MSG(msg_body, WCN36XX_HAL_FINISH_SCAN_REQ);
 
 	msg_body.mode = mode;
+	msg_body.oper_channel = WCN36XX_HW_CHANNEL(wcn);
+	if (vif) {
+		/* Tell the BSS we are back with a null frame */
+		vif_priv = wcn36xx_vif_to_priv(vif);
+		memcpy(msg_body.bssid, vif->bss_conf.bssid, ETH_ALEN);
+		msg_body.notify = 1;
+		msg_body.frame_type = 2;
+		msg_body.scan_entry.bss_index[0] = vif_priv->bss_index;
+		msg_body.scan_entry.active_bss_count = 1;
+	}
 
 	PREPARE_HAL_BUF(wcn->hal_buf, msg_body);
 
-	wcn36xx_dbg(WCN36XX_DBG_HAL, "hal finish scan mode %d\n",
-		    msg_body.mode);
+	wcn36xx_dbg(WCN36XX_DBG_HAL,
+		    "hal finish scan mode %d oper channel %d notify %d\n",
+		    msg_body.mode, msg_body.oper_channel, msg_body.notify);
 
 	ret = wcn36xx_smd_send_and_wait(wcn, msg_body.header.len);
 	if (ret) {
@@ -660,12 +883,20 @@ out:
 	return ret;
 }
 
-static int wcn36xx_smd_update_scan_params_rsp(void *buf, size_t len)
+static int wcn36xx_smd_update_scan_params_rsp(struct wcn36xx *wcn,
+					      void *buf, size_t len)
 {
 	struct wcn36xx_hal_update_scan_params_resp *rsp;
 
+	if (len < sizeof(*rsp))
+		return -EIO;
+
 	rsp = (struct wcn36xx_hal_update_scan_params_resp *)buf;
 
+	/* Firmware with the PNO version bit expects the new PNO format */
+	wcn->pno_new_api = !!(rsp->status & WCN36XX_FW_MSG_PNO_VERSION_MASK);
+	wcn->pno_known = true;
+
 	/* Remove the PNO version bit */
 	rsp->status &= (~(WCN36XX_FW_MSG_PNO_VERSION_MASK));
 
@@ -677,7 +908,8 @@ static int wcn36xx_smd_update_scan_params_rsp(void *buf, size_t len)
 	return 0;
 }
 
-int wcn36xx_smd_update_scan_params(struct wcn36xx *wcn)
+int wcn36xx_smd_update_scan_params(struct wcn36xx *wcn, u8 *channels,
+				   size_t channel_count)
 {
 	struct wcn36xx_hal_update_scan_params_req msg_body;
 	int ret = 0;
@@ -687,7 +919,9 @@ int wcn36xx_smd_update_scan_params(struct wcn36xx *wcn)
 
 	msg_body.dot11d_enabled	= 0;
 	msg_body.dot11d_resolved = 0;
-	msg_body.channel_count = 26;
+	msg_body.channel_count = min_t(size_t, channel_count,
+				       ARRAY_SIZE(msg_body.channels));
+	memcpy(msg_body.channels, channels, msg_body.channel_count);
 	msg_body.active_min_ch_time = 60;
 	msg_body.active_max_ch_time = 120;
 	msg_body.passive_min_ch_time = 60;
@@ -705,7 +939,7 @@ int wcn36xx_smd_update_scan_params(struct wcn36xx *wcn)
 		wcn36xx_err("Sending hal_update_scan_params failed\n");
 		goto out;
 	}
-	ret = wcn36xx_smd_update_scan_params_rsp(wcn->hal_buf,
+	ret = wcn36xx_smd_update_scan_params_rsp(wcn, wcn->hal_buf,
 						 wcn->hal_rsp_len);
 	if (ret) {
 		wcn36xx_err("hal_update_scan_params response failed err=%d\n",
@@ -717,6 +951,257 @@ out:
 	return ret;
 }
 
+static size_t wcn36xx_smd_pno_probe_tmpl(struct wcn36xx *wcn,
+					 struct ieee80211_vif *vif,
+					 struct ieee80211_sched_scan_ies *ies,
+					 enum ieee80211_band band, u8 *tmpl)
+{
+	struct sk_buff *skb;
+	size_t len = 0;
+
+	skb = ieee80211_probereq_get(wcn->hw, vif, NULL, 0, ies->len[band]);
+	if (!skb)
+		return 0;
+
+	if (ies->len[band])
+		memcpy(skb_put(skb, ies->len[band]), ies->ie[band],
+		       ies->len[band]);
+
+	if (skb->len <= WCN36XX_HAL_PNO_MAX_PROBE_SIZE) {
+		memcpy(tmpl, skb->data, skb->len);
+		len = skb->len;
+	} else {
+		wcn36xx_warn("PNO probe template too big: %d\n", skb->len);
+	}
+
+	dev_kfree_skb(skb);
+	return len;
+}
+
+int wcn36xx_smd_set_pref_netw_list(struct wcn36xx *wcn,
+				   struct ieee80211_vif *vif,
+				   struct cfg80211_sched_scan_request *req,
+				   struct ieee80211_sched_scan_ies *ies)
+{
+	struct set_pref_netw_list_req_new *msg_body;
+	struct network_type_new *netw;
+	const struct cfg80211_ssid *ssid;
+	int ret, i, j, n_ssids;
+
+	mutex_lock(&wcn->hal_mutex);
+	INIT_HAL_BUF_MSG(wcn, msg_body, WCN36XX_HAL_SET_PREF_NETWORK_REQ);
+
+	msg_body->enable = 1;
+	msg_body->mode = PNO_MODE_IMMEDIATE;
+
+	/* Match sets are what we look for, fall back to the probed SSIDs */
+	n_ssids = req->n_match_sets ? req->n_match_sets : req->n_ssids;
+	msg_body->networks_count = min_t(int, n_ssids,
+					 WCN36XX_HAL_PNO_MAX_SUPP_NETWORKS);
+	for (i = 0; i < msg_body->networks_count; i++) {
+		netw = &msg_body->networks[i];
+		ssid = req->n_match_sets ? &req->match_sets[i].ssid :
+					   &req->ssids[i];
+
+		netw->ssid.length = min_t(u8, ssid->ssid_len,
+					  sizeof(netw->ssid.ssid));
+		memcpy(netw->ssid.ssid, ssid->ssid, netw->ssid.length);
+		netw->authentication = AUTH_TYPE_ANY;
+		netw->encryption = ED_ANY;
+		netw->bcast_network_type = BCAST_UNKNOWN;
+		if (req->n_match_sets && req->match_sets[i].rssi_thold < 0)
+			netw->rssi_threshold = -req->match_sets[i].rssi_thold;
+
+		/* A channel count of 0 means all channels */
+		if (req->n_channels <= ARRAY_SIZE(netw->channels)) {
+			netw->channel_count = req->n_channels;
+			for (j = 0; j < req->n_channels; j++)
+				netw->channels[j] = req->channels[j]->hw_value;
+		}
+	}
+
+	/* Uniform interval, in seconds */
+	msg_body->scan_timers.count = 1;
+	msg_body->scan_timers.values[0].value =
+		max_t(u32, DIV_ROUND_UP(req->interval, MSEC_PER_SEC), 1);
+	msg_body->scan_timers.values[0].repeat = 0;
+
+	msg_body->band_24g_probe_size =
+		wcn36xx_smd_pno_probe_tmpl(wcn, vif, ies, IEEE80211_BAND_2GHZ,
+					   msg_body->band_24g_probe_template);
+	msg_body->band_5g_probe_size =
+		wcn36xx_smd_pno_probe_tmpl(wcn, vif, ies, IEEE80211_BAND_5GHZ,
+					   msg_body->band_5g_probe_template);
+
+	wcn36xx_dbg(WCN36XX_DBG_HAL,
+		    "hal set pref netw list networks %d interval %us\n",
+		    msg_body->networks_count,
+		    msg_body->scan_timers.values[0].value);
+
+	ret = wcn36xx_smd_send_and_wait(wcn, msg_body->header.len);
+	if (ret) {
+		wcn36xx_err("Sending hal_set_pref_netw_list failed\n");
+		goto out;
+	}
+	ret = wcn36xx_smd_rsp_status_check(wcn->hal_buf, wcn->hal_rsp_len);
+	if (ret) {
+		wcn36xx_err("hal_set_pref_netw_list response failed err=%d\n",
+			    ret);
+		goto out;
+	}
+out:
+	mutex_unlock(&wcn->hal_mutex);
+	return ret;
+}
+
+int wcn36xx_smd_stop_pno(struct wcn36xx *wcn)
+{
+	struct set_pref_netw_list_req_new *msg_body;
+	int ret;
+
+	mutex_lock(&wcn->hal_mutex);
+	INIT_HAL_BUF_MSG(wcn, msg_body, WCN36XX_HAL_SET_PREF_NETWORK_REQ);
+
+	msg_body->enable = 0;
+
+	wcn36xx_dbg(WCN36XX_DBG_HAL, "hal stop pno\n");
+
+	ret = wcn36xx_smd_send_and_wait(wcn, msg_body->header.len);
+	if (ret) {
+		wcn36xx_err("Sending hal_set_pref_netw_list failed\n");
+		goto out;
+	}
+	ret = wcn36xx_smd_rsp_status_check(wcn->hal_buf, wcn->hal_rsp_len);
+	if (ret) {
+		wcn36xx_err("hal_set_pref_netw_list response failed err=%d\n",
+			    ret);
+		goto out;
+	}
+out:
+	mutex_unlock(&wcn->hal_mutex);
+	return ret;
+}
+
+/* No probe requests without SSIDs or where regulatory forbids them */
+static bool wcn36xx_smd_scan_passive(struct cfg80211_scan_request *req,
+				     struct ieee80211_channel *chan)
+{
+	return !req->n_ssids || chan->flags & IEEE80211_CHAN_NO_IR;
+}
+
+/*
+ * The offload request carries a single scan type, so the channel list is
+ * sent in runs of channels sharing one, starting at wcn->scan_next. The
+ * next run is started from the completion indication of the previous.
+ */
+int wcn36xx_smd_start_hw_scan(struct wcn36xx *wcn, struct ieee80211_vif *vif,
+			      struct cfg80211_scan_request *req)
+{
+	struct wcn36xx_hal_start_scan_offload_req_msg *msg_body;
+	bool passive;
+	int ret, i;
+
+	if (req->ie_len > WCN36XX_HAL_BUF_SIZE - sizeof(*msg_body))
+		return -EINVAL;
+	if (wcn->scan_next >= req->n_channels)
+		return -EINVAL;
+
+	mutex_lock(&wcn->hal_mutex);
+	INIT_HAL_BUF_MSG(wcn, msg_body, WCN36XX_HAL_START_SCAN_OFFLOAD_REQ);
+
+	passive = wcn36xx_smd_scan_passive(req, req->channels[wcn->scan_next]);
+	if (passive) {
+		msg_body->scan_type = WCN36XX_HAL_SCAN_TYPE_PASSIVE;
+		msg_body->min_ch_time = WCN36XX_SCAN_PASSIVE_DWELL;
+		msg_body->max_ch_time = WCN36XX_SCAN_PASSIVE_DWELL;
+	} else {
+		msg_body->scan_type = WCN36XX_HAL_SCAN_TYPE_ACTIVE;
+		msg_body->min_ch_time = WCN36XX_SCAN_ACTIVE_DWELL;
+		msg_body->max_ch_time = 100;
+	}
+	msg_body->scan_hidden = 1;
+	memcpy(msg_body->mac, vif->addr, ETH_ALEN);
+	msg_body->bss_type = WCN36XX_HAL_INFRASTRUCTURE_MODE;
+	msg_body->p2p_search = vif->p2p;
+
+	if (!passive) {
+		msg_body->num_ssid = min_t(u8, req->n_ssids,
+					   ARRAY_SIZE(msg_body->ssids));
+		for (i = 0; i < msg_body->num_ssid; i++) {
+			msg_body->ssids[i].length =
+				min_t(u8, req->ssids[i].ssid_len,
+				      sizeof(msg_body->ssids[i].ssid));
+			memcpy(msg_body->ssids[i].ssid, req->ssids[i].ssid,
+			       msg_body->ssids[i].length);
+		}
+	}
+
+	for (i = wcn->scan_next; i < req->n_channels &&
+	     msg_body->num_channel < ARRAY_SIZE(msg_body->channels); i++) {
+		if (wcn36xx_smd_scan_passive(req, req->channels[i]) != passive)
+			break;
+		msg_body->channels[msg_body->num_channel++] =
+			req->channels[i]->hw_value;
+	}
+	wcn->scan_next = i;
+
+	/* Probe request IEs follow the fixed part of the message */
+	if (!passive) {
+		msg_body->ie_len = req->ie_len;
+		memcpy(wcn->hal_buf + sizeof(*msg_body), req->ie, req->ie_len);
+		msg_body->header.len += req->ie_len;
+	}
+
+	wcn36xx_dbg(WCN36XX_DBG_HAL,
+		    "hal start hw-scan (channels: %u; ssids: %u; p2p: %s; %s; next %d/%u)\n",
+		    msg_body->num_channel, msg_body->num_ssid,
+		    msg_body->p2p_search ? "yes" : "no",
+		    passive ? "passive" : "active",
+		    wcn->scan_next, req->n_channels);
+
+	ret = wcn36xx_smd_send_and_wait(wcn, msg_body->header.len);
+	if (ret) {
+		wcn36xx_err("Sending hal_start_scan_offload failed\n");
+		goto out;
+	}
+	ret = wcn36xx_smd_rsp_status_check(wcn->hal_buf, wcn->hal_rsp_len);
+	if (ret) {
+		wcn36xx_err("hal_start_scan_offload response failed err=%d\n",
+			    ret);
+		goto out;
+	}
+out:
+	mutex_unlock(&wcn->hal_mutex);
+	return ret;
+}
+
+int wcn36xx_smd_stop_hw_scan(struct wcn36xx *wcn)
+{
+	struct wcn36xx_hal_stop_scan_offload_req_msg msg_body;
+	int ret;
+
+	mutex_lock(&wcn->hal_mutex);
+	INIT_HAL_MSG(msg_body, WCN36XX_HAL_STOP_SCAN_OFFLOAD_REQ);
+	PREPARE_HAL_BUF(wcn->hal_buf, msg_body);
+
+	wcn36xx_dbg(WCN36XX_DBG_HAL, "hal stop hw-scan\n");
+
+	ret = wcn36xx_smd_send_and_wait(wcn, msg_body.header.len);
+	if (ret) {
+		wcn36xx_err("Sending hal_stop_scan_offload failed\n");
+		goto out;
+	}
+	ret = wcn36xx_smd_rsp_status_check(wcn->hal_buf, wcn->hal_rsp_len);
+	if (ret) {
+		wcn36xx_err("hal_stop_scan_offload response failed err=%d\n",
+			    ret);
+		goto out;
+	}
+out:
+	mutex_unlock(&wcn->hal_mutex);
+	return ret;
+}
+
 static int wcn36xx_smd_add_sta_self_rsp(struct wcn36xx *wcn,
 					struct ieee80211_vif *vif,
 					void *buf,
@@ -1075,96 +1560,96 @@ out:
 static int wcn36xx_smd_config_bss_v1(struct wcn36xx *wcn,
 			const struct wcn36xx_hal_config_bss_req_msg *orig)
 {
-	struct wcn36xx_hal_config_bss_req_msg_v1 msg_body;
-	struct wcn36xx_hal_config_bss_params_v1 *bss = &msg_body.bss_params;
-	struct wcn36xx_hal_config_sta_params_v1 *sta = &bss->sta;
+	struct wcn36xx_hal_config_bss_req_msg_v1 *msg_body;
+	struct wcn36xx_hal_config_bss_params_v1 *bss;
+	struct wcn36xx_hal_config_sta_params_v1 *sta;
 
-	INIT_HAL_MSG(msg_body, WCN36XX_HAL_CONFIG_BSS_REQ);
+	INIT_HAL_BUF_MSG(wcn, msg_body, WCN36XX_HAL_CONFIG_BSS_REQ);
+	bss = &msg_body->bss_params;
+	sta = &bss->sta;
 
 	/* convert orig to v1 */
-	memcpy(&msg_body.bss_params.bssid,
+	memcpy(&msg_body->bss_params.bssid,
 	       &orig->bss_params.bssid, ETH_ALEN);
-	memcpy(&msg_body.bss_params.self_mac_addr,
+	memcpy(&msg_body->bss_params.self_mac_addr,
 	       &orig->bss_params.self_mac_addr, ETH_ALEN);
 
-	msg_body.bss_params.bss_type = orig->bss_params.bss_type;
-	msg_body.bss_params.oper_mode = orig->bss_params.oper_mode;
-	msg_body.bss_params.nw_type = orig->bss_params.nw_type;
+	msg_body->bss_params.bss_type = orig->bss_params.bss_type;
+	msg_body->bss_params.oper_mode = orig->bss_params.oper_mode;
+	msg_body->bss_params.nw_type = orig->bss_params.nw_type;
 
-	msg_body.bss_params.short_slot_time_supported =
+	msg_body->bss_params.short_slot_time_supported =
 		orig->bss_params.short_slot_time_supported;
-	msg_body.bss_params.lla_coexist = orig->bss_params.lla_coexist;
-	msg_body.bss_params.llb_coexist = orig->bss_params.llb_coexist;
-	msg_body.bss_params.llg_coexist = orig->bss_params.llg_coexist;
-	msg_body.bss_params.ht20_coexist = orig->bss_params.ht20_coexist;
-	msg_body.bss_params.lln_non_gf_coexist =
+	msg_body->bss_params.lla_coexist = orig->bss_params.lla_coexist;
+	msg_body->bss_params.llb_coexist = orig->bss_params.llb_coexist;
+	msg_body->bss_params.llg_coexist = orig->bss_params.llg_coexist;
+	msg_body->bss_params.ht20_coexist = orig->bss_params.ht20_coexist;
+	msg_body->bss_params.lln_non_gf_coexist =
 		orig->bss_params.lln_non_gf_coexist;
 
-	msg_body.bss_params.lsig_tx_op_protection_full_support =
+	msg_body->bss_params.lsig_tx_op_protection_full_support =
 		orig->bss_params.lsig_tx_op_protection_full_support;
-	msg_body.bss_params.rifs_mode = orig->bss_params.rifs_mode;
-	msg_body.bss_params.beacon_interval = orig->bss_params.beacon_interval;
-	msg_body.bss_params.dtim_period = orig->bss_params.dtim_period;
-	msg_body.bss_params.tx_channel_width_set =
+	msg_body->bss_params.rifs_mode = orig->bss_params.rifs_mode;
+	msg_body->bss_params.beacon_interval = orig->bss_params.beacon_interval;
+	msg_body->bss_params.dtim_period = orig->bss_params.dtim_period;
+	msg_body->bss_params.tx_channel_width_set =
 		orig->bss_params.tx_channel_width_set;
-	msg_body.bss_params.oper_channel = orig->bss_params.oper_channel;
-	msg_body.bss_params.ext_channel = orig->bss_params.ext_channel;
+	msg_body->bss_params.oper_channel = orig->bss_params.oper_channel;
+	msg_body->bss_params.ext_channel = orig->bss_params.ext_channel;
 
-	msg_body.bss_params.reserved = orig->bss_params.reserved;
+	msg_body->bss_params.reserved = orig->bss_params.reserved;
 
-	memcpy(&msg_body.bss_params.ssid,
+	memcpy(&msg_body->bss_params.ssid,
 	       &orig->bss_params.ssid,
 	       sizeof(orig->bss_params.ssid));
 
-	msg_body.bss_params.action = orig->bss_params.action;
-	msg_body.bss_params.rateset = orig->bss_params.rateset;
-	msg_body.bss_params.ht = orig->bss_params.ht;
-	msg_body.bss_params.obss_prot_enabled =
+	msg_body->bss_params.action = orig->bss_params.action;
+	msg_body->bss_params.rateset = orig->bss_params.rateset;
+	msg_body->bss_params.ht = orig->bss_params.ht;
+	msg_body->bss_params.obss_prot_enabled =
 		orig->bss_params.obss_prot_enabled;
-	msg_body.bss_params.rmf = orig->bss_params.rmf;
-	msg_body.bss_params.ht_oper_mode = orig->bss_params.ht_oper_mode;
-	msg_body.bss_params.dual_cts_protection =
+	msg_body->bss_params.rmf = orig->bss_params.rmf;
+	msg_body->bss_params.ht_oper_mode = orig->bss_params.ht_oper_mode;
+	msg_body->bss_params.dual_cts_protection =
 		orig->bss_params.dual_cts_protection;
 
-	msg_body.bss_params.max_probe_resp_retry_limit =
+	msg_body->bss_params.max_probe_resp_retry_limit =
 		orig->bss_params.max_probe_resp_retry_limit;
-	msg_body.bss_params.hidden_ssid = orig->bss_params.hidden_ssid;
-	msg_body.bss_params.proxy_probe_resp =
+	msg_body->bss_params.hidden_ssid = orig->bss_params.hidden_ssid;
+	msg_body->bss_params.proxy_probe_resp =
 		orig->bss_params.proxy_probe_resp;
-	msg_body.bss_params.edca_params_valid =
+	msg_body->bss_params.edca_params_valid =
 		orig->bss_params.edca_params_valid;
 
-	memcpy(&msg_body.bss_params.acbe,
+	memcpy(&msg_body->bss_params.acbe,
 	       &orig->bss_params.acbe,
 	       sizeof(orig->bss_params.acbe));
-	memcpy(&msg_body.bss_params.acbk,
+	memcpy(&msg_body->bss_params.acbk,
 	       &orig->bss_params.acbk,
 	       sizeof(orig->bss_params.acbk));
-	memcpy(&msg_body.bss_params.acvi,
+	memcpy(&msg_body->bss_params.acvi,
 	       &orig->bss_params.acvi,
 	       sizeof(orig->bss_params.acvi));
-	memcpy(&msg_body.bss_params.acvo,
+	memcpy(&msg_body->bss_params.acvo,
 	       &orig->bss_params.acvo,
 	       sizeof(orig->bss_params.acvo));
 
-	msg_body.bss_params.ext_set_sta_key_param_valid =
+	msg_body->bss_params.ext_set_sta_key_param_valid =
 		orig->bss_params.ext_set_sta_key_param_valid;
 
-	memcpy(&msg_body.bss_params.ext_set_sta_key_param,
+	memcpy(&msg_body->bss_params.ext_set_sta_key_param,
 	       &orig->bss_params.ext_set_sta_key_param,
 	       sizeof(orig->bss_params.acvo));
 
-	msg_body.bss_params.wcn36xx_hal_persona =
+	msg_body->bss_params.wcn36xx_hal_persona =
 		orig->bss_params.wcn36xx_hal_persona;
-	msg_body.bss_params.spectrum_mgt_enable =
+	msg_body->bss_params.spectrum_mgt_enable =
 		orig->bss_params.spectrum_mgt_enable;
-	msg_body.bss_params.tx_mgmt_power = orig->bss_params.tx_mgmt_power;
-	msg_body.bss_params.max_tx_power = orig->bss_params.max_tx_power;
+	msg_body->bss_params.tx_mgmt_power = orig->bss_params.tx_mgmt_power;
+	msg_body->bss_params.max_tx_power = orig->bss_params.max_tx_power;
 
 	wcn36xx_smd_convert_sta_to_v1(wcn, &orig->bss_params.sta,
-				      &msg_body.bss_params.sta);
-
-	PREPARE_HAL_BUF(wcn->hal_buf, msg_body);
+				      &msg_body->bss_params.sta);
 
 	wcn36xx_dbg(WCN36XX_DBG_HAL,
 		    "hal config bss v1 bssid %pM self_mac_addr %pM bss_type %d oper_mode %d nw_type %d\n",
@@ -1176,7 +1661,7 @@ static int wcn36xx_smd_config_bss_v1(struct wcn36xx *wcn,
 		    sta->bssid, sta->action, sta->sta_index,
 		    sta->bssid_index, sta->aid, sta->type, sta->mac);
 
-	return wcn36xx_smd_send_and_wait(wcn, msg_body.header.len);
+	return wcn36xx_smd_send_and_wait(wcn, msg_body->header.len);
 }
 
 
@@ -1228,16 +1713,28 @@ int wcn36xx_smd_config_bss(struct wcn36xx *wcn, struct ieee80211_vif *vif,
 			   struct ieee80211_sta *sta, const u8 *bssid,
 			   bool update)
 {
-	struct wcn36xx_hal_config_bss_req_msg msg;
+	struct wcn36xx_hal_config_bss_req_msg *msg;
 	struct wcn36xx_hal_config_bss_params *bss;
 	struct wcn36xx_hal_config_sta_params *sta_params;
 	struct wcn36xx_vif *vif_priv = wcn36xx_vif_to_priv(vif);
 	int ret = 0;
 
 	mutex_lock(&wcn->hal_mutex);
-	INIT_HAL_MSG(msg, WCN36XX_HAL_CONFIG_BSS_REQ);
 
-	bss = &msg.bss_params;
+	/*
+	 * The v1 conversion builds its message at the start of hal_buf, so
+	 * the generic one goes to the end where it is not overwritten.
+	 */
+	BUILD_BUG_ON(sizeof(struct wcn36xx_hal_config_bss_req_msg) +
+		     sizeof(struct wcn36xx_hal_config_bss_req_msg_v1) >
+		     WCN36XX_HAL_BUF_SIZE);
+	if (!wcn36xx_is_fw_version(wcn, 1, 2, 2, 24))
+		INIT_HAL_BUF_MSG_AT(wcn, msg, WCN36XX_HAL_CONFIG_BSS_REQ,
+				    WCN36XX_HAL_BUF_SIZE - sizeof(*msg));
+	else
+		INIT_HAL_BUF_MSG(wcn, msg, WCN36XX_HAL_CONFIG_BSS_REQ);
+
+	bss = &msg->bss_params;
 	sta_params = &bss->sta;
 
 	WARN_ON(is_zero_ether_addr(bssid));
@@ -1304,9 +1801,9 @@ int wcn36xx_smd_config_bss(struct wcn36xx *wcn, struct ieee80211_vif *vif,
 	bss->max_probe_resp_retry_limit = 0;
 	bss->hidden_ssid = vif->bss_conf.hidden_ssid;
 	bss->proxy_probe_resp = 0;
-	bss->edca_params_valid = 0;
-
-	/* FIXME: set acbe, acbk, acvi and acvo */
+	bss->edca_params_valid = vif_priv->edca_valid;
+	wcn36xx_smd_fill_edca(vif_priv, &bss->acbe, &bss->acbk, &bss->acvi,
+			      &bss->acvo);
 
 	bss->ext_set_sta_key_param_valid = 0;
 
@@ -1331,11 +1828,9 @@ int wcn36xx_smd_config_bss(struct wcn36xx *wcn, struct ieee80211_vif *vif,
 		    sta_params->mac);
 
 	if (!wcn36xx_is_fw_version(wcn, 1, 2, 2, 24)) {
-		ret = wcn36xx_smd_config_bss_v1(wcn, &msg);
+		ret = wcn36xx_smd_config_bss_v1(wcn, msg);
 	} else {
-		PREPARE_HAL_BUF(wcn->hal_buf, msg);
-
-		ret = wcn36xx_smd_send_and_wait(wcn, msg.header.len);
+		ret = wcn36xx_smd_send_and_wait(wcn, msg->header.len);
 	}
 	if (ret) {
 		wcn36xx_err("Sending hal_config_bss failed\n");
@@ -1380,6 +1875,7 @@ int wcn36xx_smd_delete_bss(struct wcn36xx *wcn, struct ieee80211_vif *vif)
 		wcn36xx_err("hal_delete_bss response failed err=%d\n", ret);
 		goto out;
 	}
+	vif_priv->bss_index = WCN36XX_HAL_BSS_INVALID_IDX;
 out:
 	mutex_unlock(&wcn->hal_mutex);
 	return ret;
@@ -1389,11 +1885,11 @@ int wcn36xx_smd_send_beacon(struct wcn36xx *wcn, struct ieee80211_vif *vif,
 			    struct sk_buff *skb_beacon, u16 tim_off,
 			    u16 p2p_off)
 {
-	struct wcn36xx_hal_send_beacon_req_msg msg_body;
+	struct wcn36xx_hal_send_beacon_req_msg *msg_body;
 	int ret = 0, pad, pvm_len;
 
 	mutex_lock(&wcn->hal_mutex);
-	INIT_HAL_MSG(msg_body, WCN36XX_HAL_SEND_BEACON_REQ);
+	INIT_HAL_BUF_MSG(wcn, msg_body, WCN36XX_HAL_SEND_BEACON_REQ);
 
 	pvm_len = skb_beacon->data[tim_off + 1] - 3;
 	pad = TIM_MIN_PVM_SIZE - pvm_len;
@@ -1402,18 +1898,18 @@ int wcn36xx_smd_send_beacon(struct wcn36xx *wcn, struct ieee80211_vif *vif,
 	if (vif->type == NL80211_IFTYPE_MESH_POINT)
 		pad = 0;
 
-	msg_body.beacon_length = skb_beacon->len + pad;
+	msg_body->beacon_length = skb_beacon->len + pad;
 	/* TODO need to find out why + 6 is needed */
-	msg_body.beacon_length6 = msg_body.beacon_length + 6;
+	msg_body->beacon_length6 = msg_body->beacon_length + 6;
 
-	if (msg_body.beacon_length > BEACON_TEMPLATE_SIZE) {
+	if (msg_body->beacon_length > BEACON_TEMPLATE_SIZE) {
 		wcn36xx_err("Beacon is to big: beacon size=%d\n",
-			      msg_body.beacon_length);
+			      msg_body->beacon_length);
 		ret = -ENOMEM;
 		goto out;
 	}
-	memcpy(msg_body.beacon, skb_beacon->data, skb_beacon->len);
-	memcpy(msg_body.bssid, vif->addr, ETH_ALEN);
+	memcpy(msg_body->beacon, skb_beacon->data, skb_beacon->len);
+	memcpy(msg_body->bssid, vif->addr, ETH_ALEN);
 
 	if (pad > 0) {
 		/*
@@ -1424,27 +1920,26 @@ int wcn36xx_smd_send_beacon(struct wcn36xx *wcn, struct ieee80211_vif *vif,
 		 */
 		wcn36xx_dbg(WCN36XX_DBG_HAL, "Pad TIM PVM. %d bytes at %d\n",
 			    pad, pvm_len);
-		memmove(&msg_body.beacon[tim_off + 5 + pvm_len + pad],
-			&msg_body.beacon[tim_off + 5 + pvm_len],
+		memmove(&msg_body->beacon[tim_off + 5 + pvm_len + pad],
+			&msg_body->beacon[tim_off + 5 + pvm_len],
 			skb_beacon->len - (tim_off + 5 + pvm_len));
-		memset(&msg_body.beacon[tim_off + 5 + pvm_len], 0, pad);
-		msg_body.beacon[tim_off + 1] += pad;
+		memset(&msg_body->beacon[tim_off + 5 + pvm_len], 0, pad);
+		msg_body->beacon[tim_off + 1] += pad;
 	}
 
 	/* TODO need to find out why this is needed? */
 	if (vif->type == NL80211_IFTYPE_MESH_POINT)
 		/* mesh beacon don't need this, so push further down */
-		msg_body.tim_ie_offset = 256;
+		msg_body->tim_ie_offset = 256;
 	else
-		msg_body.tim_ie_offset = tim_off+4;
-	msg_body.p2p_ie_offset = p2p_off;
-	PREPARE_HAL_BUF(wcn->hal_buf, msg_body);
+		msg_body->tim_ie_offset = tim_off+4;
+	msg_body->p2p_ie_offset = p2p_off;
 
 	wcn36xx_dbg(WCN36XX_DBG_HAL,
 		    "hal send beacon beacon_length %d\n",
-		    msg_body.beacon_length);
+		    msg_body->beacon_length);
 
-	ret = wcn36xx_smd_send_and_wait(wcn, msg_body.header.len);
+	ret = wcn36xx_smd_send_and_wait(wcn, msg_body->header.len);
 	if (ret) {
 		wcn36xx_err("Sending hal_send_beacon failed\n");
 		goto out;
@@ -1463,11 +1958,11 @@ int wcn36xx_smd_update_proberesp_tmpl(struct wcn36xx *wcn,
 				      struct ieee80211_vif *vif,
 				      struct sk_buff *skb)
 {
-	struct wcn36xx_hal_send_probe_resp_req_msg msg;
+	struct wcn36xx_hal_send_probe_resp_req_msg *msg;
 	int ret = 0;
 
 	mutex_lock(&wcn->hal_mutex);
-	INIT_HAL_MSG(msg, WCN36XX_HAL_UPDATE_PROBE_RSP_TEMPLATE_REQ);
+	INIT_HAL_BUF_MSG(wcn, msg, WCN36XX_HAL_UPDATE_PROBE_RSP_TEMPLATE_REQ);
 
 	if (skb->len > BEACON_TEMPLATE_SIZE) {
 		wcn36xx_warn("probe response template is too big: %d\n",
@@ -1476,18 +1971,16 @@ int wcn36xx_smd_update_proberesp_tmpl(struct wcn36xx *wcn,
 		goto out;
 	}
 
-	msg.probe_resp_template_len = skb->len;
-	memcpy(&msg.probe_resp_template, skb->data, skb->len);
+	msg->probe_resp_template_len = skb->len;
+	memcpy(msg->probe_resp_template, skb->data, skb->len);
 
-	memcpy(msg.bssid, vif->addr, ETH_ALEN);
-
-	PREPARE_HAL_BUF(wcn->hal_buf, msg);
+	memcpy(msg->bssid, vif->addr, ETH_ALEN);
 
 	wcn36xx_dbg(WCN36XX_DBG_HAL,
 		    "hal update probe rsp len %d bssid %pM\n",
-		    msg.probe_resp_template_len, msg.bssid);
+		    msg->probe_resp_template_len, msg->bssid);
 
-	ret = wcn36xx_smd_send_and_wait(wcn, msg.header.len);
+	ret = wcn36xx_smd_send_and_wait(wcn, msg->header.len);
 	if (ret) {
 		wcn36xx_err("Sending hal_update_proberesp_tmpl failed\n");
 		goto out;
@@ -1701,71 +2194,69 @@ out:
 	mutex_unlock(&wcn->hal_mutex);
 	return ret;
 }
-int wcn36xx_smd_set_power_params(struct wcn36xx *wcn, bool ignore_dtim)
+
+int wcn36xx_smd_enter_uapsd(struct wcn36xx *wcn, struct ieee80211_vif *vif)
 {
-	struct wcn36xx_hal_set_power_params_req_msg msg_body;
+	struct wcn36xx_hal_enter_uapsd_req_msg msg_body;
+	struct wcn36xx_vif *vif_priv = wcn36xx_vif_to_priv(vif);
+	u8 acs = vif_priv->uapsd_acs;
 	int ret = 0;
 
 	mutex_lock(&wcn->hal_mutex);
-	INIT_HAL_MSG(msg_body, WCN36XX_HAL_SET_POWER_PARAMS_REQ);
-
-	/*
-	 * When host is down ignore every second dtim
-	 */
-	if (ignore_dtim) {
-		msg_body.ignore_dtim = 1;
-		msg_body.dtim_period = 2;
-	}
-	msg_body.listen_interval = WCN36XX_LISTEN_INTERVAL(wcn);
+	INIT_HAL_MSG(msg_body, WCN36XX_HAL_ENTER_UAPSD_REQ);
+
+	/* Every U-APSD AC is both trigger and delivery enabled */
+	msg_body.bk_delivery = msg_body.bk_trigger =
+		!!(acs & BIT(IEEE80211_AC_BK));
+	msg_body.be_delivery = msg_body.be_trigger =
+		!!(acs & BIT(IEEE80211_AC_BE));
+	msg_body.vi_delivery = msg_body.vi_trigger =
+		!!(acs & BIT(IEEE80211_AC_VI));
+	msg_body.vo_delivery = msg_body.vo_trigger =
+		!!(acs & BIT(IEEE80211_AC_VO));
+	msg_body.bss_index = vif_priv->bss_index;
 
 	PREPARE_HAL_BUF(wcn->hal_buf, msg_body);
 
+	wcn36xx_dbg(WCN36XX_DBG_HAL, "hal enter uapsd bss %d acs 0x%x\n",
+		    msg_body.bss_index, acs);
+
 	ret = wcn36xx_smd_send_and_wait(wcn, msg_body.header.len);
 	if (ret) {
-		wcn36xx_err("Sending hal_set_power_params failed\n");
+		wcn36xx_err("Sending hal_enter_uapsd failed\n");
+		goto out;
+	}
+	ret = wcn36xx_smd_rsp_status_check(wcn->hal_buf, wcn->hal_rsp_len);
+	if (ret) {
+		wcn36xx_err("hal_enter_uapsd response failed err=%d\n", ret);
 		goto out;
 	}
-
 out:
 	mutex_unlock(&wcn->hal_mutex);
 	return ret;
 }
-/* Notice: This function should be called after associated, or else it
- * will be invalid
- */
-int wcn36xx_smd_keep_alive_req(struct wcn36xx *wcn,
-			       struct ieee80211_vif *vif,
-			       int packet_type)
+
+int wcn36xx_smd_exit_uapsd(struct wcn36xx *wcn, struct ieee80211_vif *vif)
 {
-	struct wcn36xx_hal_keep_alive_req_msg msg_body;
+	struct wcn36xx_hal_exit_uapsd_req_msg msg_body;
 	struct wcn36xx_vif *vif_priv = wcn36xx_vif_to_priv(vif);
 	int ret = 0;
 
 	mutex_lock(&wcn->hal_mutex);
-	INIT_HAL_MSG(msg_body, WCN36XX_HAL_KEEP_ALIVE_REQ);
+	INIT_HAL_MSG(msg_body, WCN36XX_HAL_EXIT_UAPSD_REQ);
 
-	if (packet_type == WCN36XX_HAL_KEEP_ALIVE_NULL_PKT) {
-		msg_body.bss_index = vif_priv->bss_index;
-		msg_body.packet_type = WCN36XX_HAL_KEEP_ALIVE_NULL_PKT;
-		msg_body.time_period = WCN36XX_KEEP_ALIVE_TIME_PERIOD;
-	} else if (packet_type == WCN36XX_HAL_KEEP_ALIVE_UNSOLICIT_ARP_RSP) {
-		/* TODO: it also support ARP response type */
-	} else {
-		wcn36xx_warn("unknow keep alive packet type %d\n", packet_type);
-		ret = -EINVAL;
-		goto out;
-	}
+	msg_body.bss_index = vif_priv->bss_index;
 
 	PREPARE_HAL_BUF(wcn->hal_buf, msg_body);
 
 	ret = wcn36xx_smd_send_and_wait(wcn, msg_body.header.len);
 	if (ret) {
-		wcn36xx_err("Sending hal_keep_alive failed\n");
+		wcn36xx_err("Sending hal_exit_uapsd failed\n");
 		goto out;
 	}
 	ret = wcn36xx_smd_rsp_status_check(wcn->hal_buf, wcn->hal_rsp_len);
 	if (ret) {
-		wcn36xx_err("hal_keep_alive response failed err=%d\n", ret);
+		wcn36xx_err("hal_exit_uapsd response failed err=%d\n", ret);
 		goto out;
 	}
 out:
@@ -1773,18 +2264,545 @@ out:
 	return ret;
 }
 
-int wcn36xx_smd_dump_cmd_req(struct wcn36xx *wcn, u32 arg1, u32 arg2,
-			     u32 arg3, u32 arg4, u32 arg5)
+int wcn36xx_smd_update_uapsd_params(struct wcn36xx *wcn,
+				    struct ieee80211_vif *vif,
+				    u8 sta_index)
 {
-	struct wcn36xx_hal_dump_cmd_req_msg msg_body;
+	struct wcn36xx_hal_update_uapsd_params_req_msg msg_body;
+	struct wcn36xx_vif *vif_priv = wcn36xx_vif_to_priv(vif);
 	int ret = 0;
 
 	mutex_lock(&wcn->hal_mutex);
-	INIT_HAL_MSG(msg_body, WCN36XX_HAL_DUMP_COMMAND_REQ);
+	INIT_HAL_MSG(msg_body, WCN36XX_HAL_UPDATE_UAPSD_PARAM_REQ);
 
-	msg_body.arg1 = arg1;
-	msg_body.arg2 = arg2;
-	msg_body.arg3 = arg3;
+	msg_body.sta_index = sta_index;
+	msg_body.uapsd_ac_mask = wcn36xx_smd_uapsd_mask(vif_priv->uapsd_acs);
+	msg_body.max_sp_len = wcn->hw->uapsd_max_sp_len;
+
+	PREPARE_HAL_BUF(wcn->hal_buf, msg_body);
+
+	wcn36xx_dbg(WCN36XX_DBG_HAL,
+		    "hal update uapsd params sta %d mask 0x%x max sp %d\n",
+		    msg_body.sta_index, msg_body.uapsd_ac_mask,
+		    msg_body.max_sp_len);
+
+	ret = wcn36xx_smd_send_and_wait(wcn, msg_body.header.len);
+	if (ret) {
+		wcn36xx_err("Sending hal_update_uapsd_params failed\n");
+		goto out;
+	}
+	ret = wcn36xx_smd_rsp_status_check(wcn->hal_buf, wcn->hal_rsp_len);
+	if (ret) {
+		wcn36xx_err("hal_update_uapsd_params response failed err=%d\n",
+			    ret);
+		goto out;
+	}
+out:
+	mutex_unlock(&wcn->hal_mutex);
+	return ret;
+}
+
+int wcn36xx_smd_update_edca_params(struct wcn36xx *wcn,
+				   struct ieee80211_vif *vif)
+{
+	struct update_edca_params_req_msg msg_body;
+	struct wcn36xx_vif *vif_priv = wcn36xx_vif_to_priv(vif);
+	int ret = 0;
+
+	mutex_lock(&wcn->hal_mutex);
+	INIT_HAL_MSG(msg_body, WCN36XX_HAL_UPD_EDCA_PARAMS_REQ);
+
+	msg_body.bss_index = vif_priv->bss_index;
+	wcn36xx_smd_fill_edca(vif_priv, &msg_body.acbe, &msg_body.acbk,
+			      &msg_body.acvi, &msg_body.acvo);
+
+	PREPARE_HAL_BUF(wcn->hal_buf, msg_body);
+
+	wcn36xx_dbg(WCN36XX_DBG_HAL, "hal update edca params bss %d\n",
+		    msg_body.bss_index);
+
+	ret = wcn36xx_smd_send_and_wait(wcn, msg_body.header.len);
+	if (ret) {
+		wcn36xx_err("Sending hal_update_edca_params failed\n");
+		goto out;
+	}
+	ret = wcn36xx_smd_rsp_status_check(wcn->hal_buf, wcn->hal_rsp_len);
+	if (ret) {
+		wcn36xx_err("hal_update_edca_params response failed err=%d\n",
+			    ret);
+		goto out;
+	}
+out:
+	mutex_unlock(&wcn->hal_mutex);
+	return ret;
+}
+
+int wcn36xx_smd_set_uapsd_ac_params(struct wcn36xx *wcn, u8 sta_index,
+				    u16 ac, u32 service_interval)
+{
+	struct wcn36xx_hal_set_uapsd_ac_params_req_msg msg_body;
+	/* HAL user priorities per mac80211 AC */
+	static const u8 hal_up[IEEE80211_NUM_ACS] = {
+		[IEEE80211_AC_VO] = 6,
+		[IEEE80211_AC_VI] = 5,
+		[IEEE80211_AC_BE] = 0,
+		[IEEE80211_AC_BK] = 1,
+	};
+	int ret = 0;
+
+	mutex_lock(&wcn->hal_mutex);
+	INIT_HAL_MSG(msg_body, WCN36XX_HAL_SET_UAPSD_AC_PARAMS_REQ);
+
+	msg_body.sta_idx = sta_index;
+	msg_body.ac = wcn36xx_ac_to_aci(ac);
+	msg_body.up = hal_up[ac];
+	msg_body.service_interval = service_interval;
+
+	PREPARE_HAL_BUF(wcn->hal_buf, msg_body);
+
+	wcn36xx_dbg(WCN36XX_DBG_HAL,
+		    "hal set uapsd ac params sta %d ac %d si %d\n",
+		    msg_body.sta_idx, msg_body.ac, msg_body.service_interval);
+
+	ret = wcn36xx_smd_send_and_wait(wcn, msg_body.header.len);
+	if (ret) {
+		wcn36xx_err("Sending hal_set_uapsd_ac_params failed\n");
+		goto out;
+	}
+	ret = wcn36xx_smd_rsp_status_check(wcn->hal_buf, wcn->hal_rsp_len);
+	if (ret) {
+		wcn36xx_err("hal_set_uapsd_ac_params response failed err=%d\n",
+			    ret);
+		goto out;
+	}
+out:
+	mutex_unlock(&wcn->hal_mutex);
+	return ret;
+}
+
+/*
+ * IEs whose change forwards a beacon to the host. @bitmask marks bits
+ * that are ignored, so a zero mask compares the whole byte. Entries for
+ * the same IE must be adjacent.
+ */
+static const struct beacon_filter_ie wcn36xx_bcn_filter_ies[] = {
+	{ .element_id = WLAN_EID_DS_PARAMS },
+	{ .element_id = WLAN_EID_ERP_INFO, .bitmask = 0xf8 },
+	{ .element_id = WLAN_EID_EDCA_PARAM_SET, .bitmask = 0xf0 },
+	{ .element_id = WLAN_EID_QOS_CAPA, .bitmask = 0xf0 },
+	{ .element_id = WLAN_EID_CHANNEL_SWITCH, .check_ie_presence = 1 },
+	{ .element_id = WLAN_EID_QUIET, .check_ie_presence = 1 },
+	{ .element_id = WLAN_EID_PWR_CONSTRAINT },
+	/* Secondary channel offset, width and HT protection */
+	{ .element_id = WLAN_EID_HT_OPERATION, .offset = 1, .bitmask = 0xf8 },
+	{ .element_id = WLAN_EID_HT_OPERATION, .offset = 2, .bitmask = 0xe8 },
+};
+
+int wcn36xx_smd_add_bcn_filter(struct wcn36xx *wcn, struct ieee80211_vif *vif)
+{
+	struct wcn36xx_hal_add_bcn_filter_req_msg *msg_body;
+	struct wcn36xx_vif *vif_priv = wcn36xx_vif_to_priv(vif);
+	int ret;
+
+	mutex_lock(&wcn->hal_mutex);
+	INIT_HAL_BUF_MSG(wcn, msg_body, WCN36XX_HAL_ADD_BCN_FILTER_REQ);
+
+	/* mac80211 only tracks the slot time from the capabilities */
+	if (vif->bss_conf.use_short_slot)
+		msg_body->capability_info = WLAN_CAPABILITY_SHORT_SLOT_TIME;
+	msg_body->capability_mask = WLAN_CAPABILITY_SHORT_SLOT_TIME;
+	msg_body->beacon_interval = vif->bss_conf.beacon_int;
+	msg_body->bss_index = vif_priv->bss_index;
+
+	msg_body->ie_num = ARRAY_SIZE(wcn36xx_bcn_filter_ies);
+	memcpy(wcn->hal_buf + sizeof(*msg_body), wcn36xx_bcn_filter_ies,
+	       sizeof(wcn36xx_bcn_filter_ies));
+	msg_body->header.len += sizeof(wcn36xx_bcn_filter_ies);
+
+	wcn36xx_dbg(WCN36XX_DBG_HAL,
+		    "hal add bcn filter bss %d interval %d ies %d\n",
+		    msg_body->bss_index, msg_body->beacon_interval,
+		    msg_body->ie_num);
+
+	ret = wcn36xx_smd_send_and_wait(wcn, msg_body->header.len);
+	if (ret) {
+		wcn36xx_err("Sending hal_add_bcn_filter failed\n");
+		goto out;
+	}
+	ret = wcn36xx_smd_rsp_status_check(wcn->hal_buf, wcn->hal_rsp_len);
+	if (ret) {
+		wcn36xx_err("hal_add_bcn_filter response failed err=%d\n", ret);
+		goto out;
+	}
+out:
+	mutex_unlock(&wcn->hal_mutex);
+	return ret;
+}
+
+int wcn36xx_smd_rem_bcn_filter(struct wcn36xx *wcn)
+{
+	struct wcn36xx_hal_rem_bcn_filter_req *msg_body;
+	u8 *ids;
+	int ret, i, n = 0;
+
+	mutex_lock(&wcn->hal_mutex);
+	INIT_HAL_BUF_MSG(wcn, msg_body, WCN36XX_HAL_REM_BCN_FILTER_REQ);
+
+	/* rem_ie_id[] runs past the end of the message, one byte per IE */
+	ids = msg_body->rem_ie_id;
+	for (i = 0; i < ARRAY_SIZE(wcn36xx_bcn_filter_ies); i++) {
+		if (n && ids[n - 1] == wcn36xx_bcn_filter_ies[i].element_id)
+			continue;
+		ids[n++] = wcn36xx_bcn_filter_ies[i].element_id;
+	}
+	msg_body->ie_Count = n;
+	msg_body->header.len += n - 1;
+
+	ret = wcn36xx_smd_send_and_wait(wcn, msg_body->header.len);
+	if (ret) {
+		wcn36xx_err("Sending hal_rem_bcn_filter failed\n");
+		goto out;
+	}
+	ret = wcn36xx_smd_rsp_status_check(wcn->hal_buf, wcn->hal_rsp_len);
+	if (ret) {
+		wcn36xx_err("hal_rem_bcn_filter response failed err=%d\n", ret);
+		goto out;
+	}
+out:
+	mutex_unlock(&wcn->hal_mutex);
+	return ret;
+}
+
+int wcn36xx_smd_set_rssi_thresh(struct wcn36xx *wcn, s32 thold, u32 hyst)
+{
+	struct wcn36xx_hal_rssi_threshold_req_msg msg_body;
+	int ret;
+
+	mutex_lock(&wcn->hal_mutex);
+	INIT_HAL_MSG(msg_body, WCN36XX_HAL_SET_RSSI_THRESH_REQ);
+
+	/*
+	 * Threshold 1 reports falling below the low edge and threshold 2
+	 * rising above the high edge, mac80211 CQM semantics.
+	 */
+	if (thold) {
+		msg_body.threshold1 = clamp_t(s32, thold - hyst, S8_MIN, 0);
+		msg_body.thres1_neg_notify = 1;
+		msg_body.threshold2 = clamp_t(s32, thold + hyst, S8_MIN, 0);
+		msg_body.thres2_pos_notify = 1;
+	}
+
+	PREPARE_HAL_BUF(wcn->hal_buf, msg_body);
+
+	wcn36xx_dbg(WCN36XX_DBG_HAL, "hal set rssi thresh low %d high %d\n",
+		    msg_body.threshold1, msg_body.threshold2);
+
+	ret = wcn36xx_smd_send_and_wait(wcn, msg_body.header.len);
+	if (ret) {
+		wcn36xx_err("Sending hal_set_rssi_thresh failed\n");
+		goto out;
+	}
+	ret = wcn36xx_smd_rsp_status_check(wcn->hal_buf, wcn->hal_rsp_len);
+	if (ret) {
+		wcn36xx_err("hal_set_rssi_thresh response failed err=%d\n", ret);
+		goto out;
+	}
+out:
+	mutex_unlock(&wcn->hal_mutex);
+	return ret;
+}
+
+static int wcn36xx_smd_host_offload(struct wcn36xx *wcn,
+				    struct wcn36xx_hal_host_offload_req_msg *msg)
+{
+	int ret;
+
+	PREPARE_HAL_BUF(wcn->hal_buf, (*msg));
+
+	wcn36xx_dbg(WCN36XX_DBG_HAL, "hal host offload type %d enable %d\n",
+		    msg->host_offload_params.offload_Type,
+		    msg->host_offload_params.enable);
+
+	ret = wcn36xx_smd_send_and_wait(wcn, msg->header.len);
+	if (ret) {
+		wcn36xx_err("Sending hal_host_offload failed\n");
+		return ret;
+	}
+	ret = wcn36xx_smd_rsp_status_check(wcn->hal_buf, wcn->hal_rsp_len);
+	if (ret) {
+		wcn36xx_err("hal_host_offload response failed err=%d\n", ret);
+		return ret;
+	}
+	return 0;
+}
+
+int wcn36xx_smd_arp_offload(struct wcn36xx *wcn, struct ieee80211_vif *vif,
+			    __be32 addr)
+{
+	struct wcn36xx_hal_host_offload_req_msg msg_body;
+	struct wcn36xx_vif *vif_priv = wcn36xx_vif_to_priv(vif);
+	int ret;
+
+	mutex_lock(&wcn->hal_mutex);
+	INIT_HAL_MSG(msg_body, WCN36XX_HAL_HOST_OFFLOAD_REQ);
+
+	msg_body.host_offload_params.offload_Type =
+		WCN36XX_HAL_IPV4_ARP_REPLY_OFFLOAD;
+	if (addr) {
+		msg_body.host_offload_params.enable =
+			WCN36XX_HAL_OFFLOAD_ENABLE;
+		memcpy(msg_body.host_offload_params.u.host_ipv4_addr, &addr,
+		       sizeof(addr));
+	}
+	/* Firmware takes the BSS from the NS block for every offload */
+	msg_body.ns_offload_params.bss_index = vif_priv->bss_index;
+
+	ret = wcn36xx_smd_host_offload(wcn, &msg_body);
+
+	mutex_unlock(&wcn->hal_mutex);
+	return ret;
+}
+
+int wcn36xx_smd_ns_offload(struct wcn36xx *wcn, struct ieee80211_vif *vif,
+			   const struct in6_addr *addrs, int count)
+{
+	struct wcn36xx_hal_host_offload_req_msg msg_body;
+	struct wcn36xx_hal_ns_offload_params *ns;
+	struct wcn36xx_vif *vif_priv = wcn36xx_vif_to_priv(vif);
+	struct in6_addr solicited;
+	int ret;
+
+	mutex_lock(&wcn->hal_mutex);
+	INIT_HAL_MSG(msg_body, WCN36XX_HAL_HOST_OFFLOAD_REQ);
+
+	ns = &msg_body.ns_offload_params;
+	msg_body.host_offload_params.offload_Type =
+		WCN36XX_HAL_IPV6_NS_OFFLOAD;
+	if (count) {
+		msg_body.host_offload_params.enable =
+			WCN36XX_HAL_OFFLOAD_ENABLE;
+		memcpy(msg_body.host_offload_params.u.host_ipv6_addr,
+		       &addrs[0], WCN36XX_HAL_IPV6_ADDR_LEN);
+
+		/*
+		 * Firmware matches solicitations on the solicited-node
+		 * address in self_ipv6_addr, src_ipv6_addr is not used
+		 */
+		addrconf_addr_solict_mult(&addrs[0], &solicited);
+		memcpy(ns->self_ipv6_addr, &solicited,
+		       WCN36XX_HAL_IPV6_ADDR_LEN);
+
+		memcpy(ns->target_ipv6_addr1, &addrs[0],
+		       WCN36XX_HAL_IPV6_ADDR_LEN);
+		ns->target_ipv6_addr1_valid = 1;
+		if (count > 1) {
+			memcpy(ns->target_ipv6_addr2, &addrs[1],
+			       WCN36XX_HAL_IPV6_ADDR_LEN);
+			ns->target_ipv6_addr2_valid = 1;
+		}
+	}
+	memcpy(ns->self_addr, vif->addr, ETH_ALEN);
+	ns->slot_index = 0;
+	ns->bss_index = vif_priv->bss_index;
+
+	ret = wcn36xx_smd_host_offload(wcn, &msg_body);
+
+	mutex_unlock(&wcn->hal_mutex);
+	return ret;
+}
+
+int wcn36xx_smd_gtk_offload(struct wcn36xx *wcn, struct ieee80211_vif *vif,
+			    bool enable)
+{
+	struct wcn36xx_hal_gtk_offload_req_msg msg_body;
+	struct wcn36xx_vif *vif_priv = wcn36xx_vif_to_priv(vif);
+	int ret;
+
+	mutex_lock(&wcn->hal_mutex);
+	INIT_HAL_MSG(msg_body, WCN36XX_HAL_GTK_OFFLOAD_REQ);
+
+	if (enable) {
+		memcpy(msg_body.kck, vif_priv->rekey_data.kck,
+		       WCN36XX_HAL_GTK_KCK_BYTES);
+		memcpy(msg_body.kek, vif_priv->rekey_data.kek,
+		       WCN36XX_HAL_GTK_KEK_BYTES);
+		msg_body.key_replay_counter = vif_priv->rekey_data.replay_ctr;
+	} else {
+		msg_body.flags = WCN36XX_HAL_GTK_OFFLOAD_FLAGS_DISABLE;
+	}
+	msg_body.bss_index = vif_priv->bss_index;
+
+	PREPARE_HAL_BUF(wcn->hal_buf, msg_body);
+
+	wcn36xx_dbg(WCN36XX_DBG_HAL, "hal gtk offload %s bss %d ctr %llu\n",
+		    enable ? "enable" : "disable", msg_body.bss_index,
+		    msg_body.key_replay_counter);
+
+	ret = wcn36xx_smd_send_and_wait(wcn, msg_body.header.len);
+	if (ret) {
+		wcn36xx_err("Sending hal_gtk_offload failed\n");
+		goto out;
+	}
+	ret = wcn36xx_smd_rsp_status_check(wcn->hal_buf, wcn->hal_rsp_len);
+	if (ret) {
+		wcn36xx_err("hal_gtk_offload response failed err=%d\n", ret);
+		goto out;
+	}
+out:
+	mutex_unlock(&wcn->hal_mutex);
+	return ret;
+}
+
+static int wcn36xx_smd_gtk_offload_get_info_rsp(struct wcn36xx *wcn,
+						struct ieee80211_vif *vif)
+{
+	struct wcn36xx_vif *vif_priv = wcn36xx_vif_to_priv(vif);
+	struct wcn36xx_hal_gtk_offload_get_info_rsp_msg *rsp;
+	__be64 replay_ctr;
+
+	if (wcn->hal_rsp_len < sizeof(*rsp))
+		return -EIO;
+
+	rsp = (struct wcn36xx_hal_gtk_offload_get_info_rsp_msg *)wcn->hal_buf;
+	if (rsp->status != WCN36XX_FW_MSG_RESULT_SUCCESS)
+		return rsp->status;
+
+	wcn36xx_dbg(WCN36XX_DBG_HAL,
+		    "gtk offload info status %d ctr %llu rekeys %u gtk %u igtk %u\n",
+		    rsp->last_rekey_status, rsp->key_replay_counter,
+		    rsp->total_rekey_count, rsp->gtk_rekey_count,
+		    rsp->igtk_rekey_count);
+
+	if (rsp->total_rekey_count &&
+	    rsp->last_rekey_status != WCN36XX_HAL_GTK_REKEY_STATUS_SUCCESS)
+		wcn36xx_warn("offloaded gtk rekey failed status %d\n",
+			     rsp->last_rekey_status);
+
+	/* Tell the supplicant about rekeys done while it was asleep */
+	if (rsp->key_replay_counter != vif_priv->rekey_data.replay_ctr) {
+		vif_priv->rekey_data.replay_ctr = rsp->key_replay_counter;
+		replay_ctr = cpu_to_be64(rsp->key_replay_counter);
+		ieee80211_gtk_rekey_notify(vif, vif->bss_conf.bssid,
+					   (void *)&replay_ctr, GFP_KERNEL);
+	}
+
+	return 0;
+}
+
+int wcn36xx_smd_gtk_offload_get_info(struct wcn36xx *wcn,
+				     struct ieee80211_vif *vif)
+{
+	struct wcn36xx_hal_gtk_offload_get_info_req_msg msg_body;
+	struct wcn36xx_vif *vif_priv = wcn36xx_vif_to_priv(vif);
+	int ret;
+
+	mutex_lock(&wcn->hal_mutex);
+	INIT_HAL_MSG(msg_body, WCN36XX_HAL_GTK_OFFLOAD_GETINFO_REQ);
+
+	msg_body.bss_index = vif_priv->bss_index;
+
+	PREPARE_HAL_BUF(wcn->hal_buf, msg_body);
+
+	ret = wcn36xx_smd_send_and_wait(wcn, msg_body.header.len);
+	if (ret) {
+		wcn36xx_err("Sending hal_gtk_offload_get_info failed\n");
+		goto out;
+	}
+	ret = wcn36xx_smd_gtk_offload_get_info_rsp(wcn, vif);
+	if (ret) {
+		wcn36xx_err("hal_gtk_offload_get_info response failed err=%d\n",
+			    ret);
+		goto out;
+	}
+out:
+	mutex_unlock(&wcn->hal_mutex);
+	return ret;
+}
+
+int wcn36xx_smd_set_power_params(struct wcn36xx *wcn, bool ignore_dtim)
+{
+	struct wcn36xx_hal_set_power_params_req_msg msg_body;
+	int ret = 0;
+
+	mutex_lock(&wcn->hal_mutex);
+	INIT_HAL_MSG(msg_body, WCN36XX_HAL_SET_POWER_PARAMS_REQ);
+
+	/*
+	 * When host is down ignore every second dtim
+	 */
+	if (ignore_dtim) {
+		msg_body.ignore_dtim = 1;
+		msg_body.dtim_period = 2;
+	}
+	msg_body.listen_interval = WCN36XX_LISTEN_INTERVAL(wcn);
+
+	PREPARE_HAL_BUF(wcn->hal_buf, msg_body);
+
+	ret = wcn36xx_smd_send_and_wait(wcn, msg_body.header.len);
+	if (ret) {
+		wcn36xx_err("Sending hal_set_power_params failed\n");
+		goto out;
+	}
+
+out:
+	mutex_unlock(&wcn->hal_mutex);
+	return ret;
+}
+/* Notice: This function should be called after associated, or else it
+ * will be invalid
+ */
+int wcn36xx_smd_keep_alive_req(struct wcn36xx *wcn,
+			       struct ieee80211_vif *vif,
+			       int packet_type)
+{
+	struct wcn36xx_hal_keep_alive_req_msg msg_body;
+	struct wcn36xx_vif *vif_priv = wcn36xx_vif_to_priv(vif);
+	int ret = 0;
+
+	mutex_lock(&wcn->hal_mutex);
+	INIT_HAL_MSG(msg_body, WCN36XX_HAL_KEEP_ALIVE_REQ);
+
+	if (packet_type == WCN36XX_HAL_KEEP_ALIVE_NULL_PKT) {
+		msg_body.bss_index = vif_priv->bss_index;
+		msg_body.packet_type = WCN36XX_HAL_KEEP_ALIVE_NULL_PKT;
+		msg_body.time_period = WCN36XX_KEEP_ALIVE_TIME_PERIOD;
+	} else if (packet_type == WCN36XX_HAL_KEEP_ALIVE_UNSOLICIT_ARP_RSP) {
+		/* TODO: it also support ARP response type */
+	} else {
+		wcn36xx_warn("unknow keep alive packet type %d\n", packet_type);
+		ret = -EINVAL;
+		goto out;
+	}
+
+	PREPARE_HAL_BUF(wcn->hal_buf, msg_body);
+
+	ret = wcn36xx_smd_send_and_wait(wcn, msg_body.header.len);
+	if (ret) {
+		wcn36xx_err("Sending hal_keep_alive failed\n");
+		goto out;
+	}
+	ret = wcn36xx_smd_rsp_status_check(wcn->hal_buf, wcn->hal_rsp_len);
+	if (ret) {
+		wcn36xx_err("hal_keep_alive response failed err=%d\n", ret);
+		goto out;
+	}
+out:
+	mutex_unlock(&wcn->hal_mutex);
+	return ret;
+}
+
+int wcn36xx_smd_dump_cmd_req(struct wcn36xx *wcn, u32 arg1, u32 arg2,
+			     u32 arg3, u32 arg4, u32 arg5)
+{
+	struct wcn36xx_hal_dump_cmd_req_msg msg_body;
+	int ret = 0;
+
+	mutex_lock(&wcn->hal_mutex);
+	INIT_HAL_MSG(msg_body, WCN36XX_HAL_DUMP_COMMAND_REQ);
+
+	msg_body.arg1 = arg1;
+	msg_body.arg2 = arg2;
+	msg_body.arg3 = arg3;
 	msg_body.arg4 = arg4;
 	msg_body.arg5 = arg5;
 
@@ -1882,12 +2900,55 @@ out:
 	return ret;
 }
 
+static int wcn36xx_smd_add_ba_session_rsp(struct ieee80211_sta *sta,
+					  void *buf, int len, u8 direction)
+{
+	struct wcn36xx_sta *sta_priv = wcn36xx_sta_to_priv(sta);
+	struct wcn36xx_hal_add_ba_session_rsp_msg *rsp;
+
+	if (len < sizeof(*rsp))
+		return -EINVAL;
+
+	rsp = (struct wcn36xx_hal_add_ba_session_rsp_msg *)buf;
+	if (WCN36XX_FW_MSG_RESULT_SUCCESS != rsp->status)
+		return rsp->status;
+
+	if (rsp->ba_tid >= IEEE80211_NUM_TIDS)
+		return -EINVAL;
+
+	wcn36xx_dbg(WCN36XX_DBG_HAL,
+		    "hal add ba session rsp sta %d tid %d session %d win %d\n",
+		    rsp->sta_index, rsp->ba_tid, rsp->ba_session_id,
+		    rsp->win_size);
+
+	spin_lock_bh(&sta_priv->ampdu_lock);
+	if (direction)
+		sta_priv->tx_ba_session[rsp->ba_tid] = rsp->ba_session_id;
+	else
+		sta_priv->rx_ba_session[rsp->ba_tid] = rsp->ba_session_id;
+	spin_unlock_bh(&sta_priv->ampdu_lock);
+
+	return 0;
+}
+
+/**
+ * wcn36xx_smd_add_ba_session - open a block-ack session for one TID
+ *
+ * @buf_size: firmware buffers reserved for the session
+ * @timeout: inactivity in TU after which firmware deletes the session
+ *
+ * On success the firmware session id is stored in the station's per-TID
+ * session table for @direction, where wcn36xx_smd_add_ba() and
+ * wcn36xx_smd_trigger_ba() pick it up.
+ */
 int wcn36xx_smd_add_ba_session(struct wcn36xx *wcn,
 		struct ieee80211_sta *sta,
 		u16 tid,
 		u16 *ssn,
 		u8 direction,
-		u8 sta_index)
+		u8 sta_index,
+		u16 buf_size,
+		u16 timeout)
 {
 	struct wcn36xx_hal_add_ba_session_req_msg msg_body;
 	int ret = 0;
@@ -1902,8 +2963,8 @@ int wcn36xx_smd_add_ba_session(struct wcn36xx *wcn,
 
 	/* Immediate BA because Delayed BA is not supported */
 	msg_body.policy = 1;
-	msg_body.buffer_size = WCN36XX_AGGR_BUFFER_SIZE;
-	msg_body.timeout = 0;
+	msg_body.buffer_size = buf_size;
+	msg_body.timeout = timeout;
 	if (ssn)
 		msg_body.ssn = *ssn;
 	msg_body.direction = direction;
@@ -1915,7 +2976,8 @@ int wcn36xx_smd_add_ba_session(struct wcn36xx *wcn,
 		wcn36xx_err("Sending hal_add_ba_session failed\n");
 		goto out;
 	}
-	ret = wcn36xx_smd_rsp_status_check(wcn->hal_buf, wcn->hal_rsp_len);
+	ret = wcn36xx_smd_add_ba_session_rsp(sta, wcn->hal_buf,
+					     wcn->hal_rsp_len, direction);
 	if (ret) {
 		wcn36xx_err("hal_add_ba_session response failed err=%d\n", ret);
 		goto out;
@@ -1925,7 +2987,7 @@ out:
 	return ret;
 }
 
-int wcn36xx_smd_add_ba(struct wcn36xx *wcn)
+int wcn36xx_smd_add_ba(struct wcn36xx *wcn, u8 session_id, u8 win_size)
 {
 	struct wcn36xx_hal_add_ba_req_msg msg_body;
 	int ret = 0;
@@ -1933,8 +2995,8 @@ int wcn36xx_smd_add_ba(struct wcn36xx *wcn)
 	mutex_lock(&wcn->hal_mutex);
 	INIT_HAL_MSG(msg_body, WCN36XX_HAL_ADD_BA_REQ);
 
-	msg_body.session_id = 0;
-	msg_body.win_size = WCN36XX_AGGR_BUFFER_SIZE;
+	msg_body.session_id = session_id;
+	msg_body.win_size = win_size;
 
 	PREPARE_HAL_BUF(wcn->hal_buf, msg_body);
 
@@ -1953,7 +3015,8 @@ out:
 	return ret;
 }
 
-int wcn36xx_smd_del_ba(struct wcn36xx *wcn, u16 tid, u8 sta_index)
+int wcn36xx_smd_del_ba(struct wcn36xx *wcn, u16 tid, u8 direction,
+		       u8 sta_index)
 {
 	struct wcn36xx_hal_del_ba_req_msg msg_body;
 	int ret = 0;
@@ -1963,7 +3026,7 @@ int wcn36xx_smd_del_ba(struct wcn36xx *wcn, u16 tid, u8 sta_index)
 
 	msg_body.sta_index = sta_index;
 	msg_body.tid = tid;
-	msg_body.direction = 0;
+	msg_body.direction = direction;
 	PREPARE_HAL_BUF(wcn->hal_buf, msg_body);
 
 	ret = wcn36xx_smd_send_and_wait(wcn, msg_body.header.len);
@@ -1992,7 +3055,15 @@ static int wcn36xx_smd_trigger_ba_rsp(void *buf, int len)
 	return rsp->status;
 }
 
-int wcn36xx_smd_trigger_ba(struct wcn36xx *wcn, u8 sta_index)
+/**
+ * wcn36xx_smd_trigger_ba - ask firmware to start aggregating on a station
+ *
+ * @session_id: firmware BA session the trigger belongs to
+ * @tid_bitmap: every TID of @sta_index with an established RX session, so
+ * that a new session does not drop the others from the candidate
+ */
+int wcn36xx_smd_trigger_ba(struct wcn36xx *wcn, u8 sta_index, u8 session_id,
+			   u8 tid_bitmap)
 {
 	struct wcn36xx_hal_trigger_ba_req_msg msg_body;
 	struct wcn36xx_hal_trigger_ba_req_candidate *candidate;
@@ -2001,7 +3072,7 @@ int wcn36xx_smd_trigger_ba(struct wcn36xx *wcn, u8 sta_index)
 	mutex_lock(&wcn->hal_mutex);
 	INIT_HAL_MSG(msg_body, WCN36XX_HAL_TRIGGER_BA_REQ);
 
-	msg_body.session_id = 0;
+	msg_body.session_id = session_id;
 	msg_body.candidate_cnt = 1;
 	msg_body.header.len += sizeof(*candidate);
 	PREPARE_HAL_BUF(wcn->hal_buf, msg_body);
@@ -2009,7 +3080,11 @@ int wcn36xx_smd_trigger_ba(struct wcn36xx *wcn, u8 sta_index)
 	candidate = (struct wcn36xx_hal_trigger_ba_req_candidate *)
 		(wcn->hal_buf + sizeof(msg_body));
 	candidate->sta_index = sta_index;
-	candidate->tid_bitmap = 1;
+	candidate->tid_bitmap = tid_bitmap;
+
+	wcn36xx_dbg(WCN36XX_DBG_HAL,
+		    "hal trigger ba sta %d session %d tid_bitmap 0x%x\n",
+		    sta_index, session_id, tid_bitmap);
 
 	ret = wcn36xx_smd_send_and_wait(wcn, msg_body.header.len);
 	if (ret) {
@@ -2078,6 +3153,42 @@ static int wcn36xx_smd_missed_beacon_ind(struct wcn36xx *wcn,
 	return -ENOENT;
 }
 
+static int wcn36xx_smd_rssi_notification_ind(struct wcn36xx *wcn,
+					     void *buf,
+					     size_t len)
+{
+	struct wcn36xx_hal_rssi_notification_ind_msg *rsp = buf;
+	enum nl80211_cqm_rssi_threshold_event event;
+	struct ieee80211_vif *vif;
+	struct wcn36xx_vif *tmp;
+
+	if (len < sizeof(*rsp)) {
+		wcn36xx_warn("Corrupted rssi notification indication\n");
+		return -EIO;
+	}
+
+	if (rsp->rssi_thres1_neg_cross)
+		event = NL80211_CQM_RSSI_THRESHOLD_EVENT_LOW;
+	else if (rsp->rssi_thres2_pos_cross)
+		event = NL80211_CQM_RSSI_THRESHOLD_EVENT_HIGH;
+	else
+		return 0;
+
+	wcn36xx_dbg(WCN36XX_DBG_HAL, "rssi notification %s avg %d\n",
+		    event == NL80211_CQM_RSSI_THRESHOLD_EVENT_LOW ?
+		    "low" : "high", -(int)rsp->avg_rssi);
+
+	/* The indication carries no bss index, thresholds are global */
+	list_for_each_entry(tmp, &wcn->vif_list, list) {
+		vif = wcn36xx_priv_to_vif(tmp);
+		if (NL80211_IFTYPE_STATION == vif->type && tmp->sta_assoc &&
+		    vif->bss_conf.cqm_rssi_thold)
+			ieee80211_cqm_rssi_notify(vif, event, GFP_KERNEL);
+	}
+
+	return 0;
+}
+
 static int wcn36xx_smd_delete_sta_context_ind(struct wcn36xx *wcn,
 					      void *buf,
 					      size_t len)
@@ -2110,6 +3221,157 @@ static int wcn36xx_smd_delete_sta_context_ind(struct wcn36xx *wcn,
 	return -ENOENT;
 }
 
+static int wcn36xx_smd_del_ba_ind(struct wcn36xx *wcn, void *buf, size_t len)
+{
+	struct wcn36xx_hal_del_ba_ind_msg *rsp = buf;
+	struct wcn36xx_sta *sta_priv;
+	struct wcn36xx_vif *tmp;
+	struct ieee80211_vif *vif;
+	struct ieee80211_sta *sta;
+	bool was_active;
+
+	if (len != sizeof(*rsp)) {
+		wcn36xx_warn("Corrupted delete ba indication\n");
+		return -EIO;
+	}
+
+	wcn36xx_dbg(WCN36XX_DBG_HAL,
+		    "delete ba indication %pM index %d tid %d direction %d reason %d\n",
+		    rsp->peer_addr, rsp->sta_idx, rsp->ba_tid, rsp->direction,
+		    rsp->reason_code);
+
+	if (rsp->ba_tid >= IEEE80211_NUM_TIDS)
+		return -EINVAL;
+
+	list_for_each_entry(tmp, &wcn->vif_list, list) {
+		vif = wcn36xx_priv_to_vif(tmp);
+
+		rcu_read_lock();
+		sta = ieee80211_find_sta(vif, rsp->peer_addr);
+		if (!sta) {
+			rcu_read_unlock();
+			continue;
+		}
+
+		/*
+		 * The firmware has already torn the session down, so clear
+		 * our state and release its accounting first. The
+		 * ampdu_action stop that mac80211 calls back into then finds
+		 * no session and sends no DEL_BA.
+		 */
+		sta_priv = wcn36xx_sta_to_priv(sta);
+		spin_lock_bh(&sta_priv->ampdu_lock);
+		if (rsp->direction) {
+			was_active =
+				atomic_cmpxchg(&sta_priv->ampdu[rsp->ba_tid].state,
+					       WCN36XX_AMPDU_OPERATIONAL,
+					       WCN36XX_AMPDU_NONE) ==
+				WCN36XX_AMPDU_OPERATIONAL;
+			if (was_active) {
+				atomic_dec(&wcn->ba_sessions);
+				atomic_sub(sta_priv->tx_ba_buf[rsp->ba_tid],
+					   &wcn->ba_buffers);
+				sta_priv->tx_ba_buf[rsp->ba_tid] = 0;
+			}
+		} else {
+			was_active = sta_priv->rx_ba_tids & BIT(rsp->ba_tid);
+			sta_priv->rx_ba_tids &= ~BIT(rsp->ba_tid);
+			if (was_active) {
+				atomic_dec(&wcn->ba_sessions);
+				atomic_sub(sta_priv->rx_ba_buf[rsp->ba_tid],
+					   &wcn->ba_buffers);
+				sta_priv->rx_ba_buf[rsp->ba_tid] = 0;
+			}
+		}
+		spin_unlock_bh(&sta_priv->ampdu_lock);
+
+		if (was_active && rsp->direction)
+			ieee80211_stop_tx_ba_session(sta, rsp->ba_tid);
+		else if (was_active)
+			ieee80211_stop_rx_ba_session(vif, BIT(rsp->ba_tid),
+						     rsp->peer_addr);
+		rcu_read_unlock();
+		return 0;
+	}
+
+	wcn36xx_warn("STA with addr %pM and index %d not found\n",
+		     rsp->peer_addr,
+		     rsp->sta_idx);
+	return -ENOENT;
+}
+
+static int wcn36xx_smd_hw_scan_ind(struct wcn36xx *wcn, void *buf, size_t len)
+{
+	struct wcn36xx_hal_scan_offload_ind *rsp = buf;
+	bool aborted;
+
+	if (len != sizeof(*rsp)) {
+		wcn36xx_warn("Corrupted scan offload indication\n");
+		return -EIO;
+	}
+
+	wcn36xx_dbg(WCN36XX_DBG_HAL, "scan indication type 0x%x freq %u\n",
+		    rsp->type, rsp->channel_mhz);
+
+	switch (rsp->type) {
+	case WCN36XX_HAL_SCAN_IND_STARTED:
+	case WCN36XX_HAL_SCAN_IND_RESTARTED:
+		break;
+	case WCN36XX_HAL_SCAN_IND_FOREIGN_CHANNEL:
+		wcn->scan_band = rsp->channel_mhz <= 2484 ?
+			IEEE80211_BAND_2GHZ : IEEE80211_BAND_5GHZ;
+		wcn->scan_freq = rsp->channel_mhz;
+		break;
+	case WCN36XX_HAL_SCAN_IND_COMPLETED:
+	case WCN36XX_HAL_SCAN_IND_FAILED:
+	case WCN36XX_HAL_SCAN_IND_DEQUEUED:
+	case WCN36XX_HAL_SCAN_IND_PREEMPTED:
+		wcn->scan_freq = 0;
+		mutex_lock(&wcn->scan_lock);
+		aborted = wcn->scan_aborted ||
+			  rsp->type != WCN36XX_HAL_SCAN_IND_COMPLETED;
+		/* Channels of the other scan type are sent as a new request */
+		if (wcn->scan_req && !aborted &&
+		    wcn->scan_next < wcn->scan_req->n_channels &&
+		    !wcn36xx_smd_start_hw_scan(wcn, wcn->scan_vif,
+					       wcn->scan_req)) {
+			mutex_unlock(&wcn->scan_lock);
+			break;
+		}
+		if (wcn->scan_req) {
+			wcn->scan_req = NULL;
+			ieee80211_scan_completed(wcn->hw, aborted);
+		}
+		mutex_unlock(&wcn->scan_lock);
+		break;
+	default:
+		wcn36xx_warn("Unknown scan indication type 0x%x\n", rsp->type);
+		break;
+	}
+
+	return 0;
+}
+
+static int wcn36xx_smd_pref_netw_found_ind(struct wcn36xx *wcn,
+					   void *buf, size_t len)
+{
+	struct pref_netw_found_ind *rsp = buf;
+
+	if (len < sizeof(*rsp)) {
+		wcn36xx_warn("Corrupted preferred network found indication\n");
+		return -EIO;
+	}
+
+	wcn36xx_dbg(WCN36XX_DBG_HAL, "preferred network found %.*s rssi %d\n",
+		    min_t(int, rsp->ssid.length, sizeof(rsp->ssid.ssid)),
+		    rsp->ssid.ssid, -rsp->rssi);
+
+	/* mac80211 has the supplicant scan for the actual BSS */
+	ieee80211_sched_scan_results(wcn->hw);
+
+	return 0;
+}
+
 int wcn36xx_smd_update_cfg(struct wcn36xx *wcn, u32 cfg_id, u32 value)
 {
 	struct wcn36xx_hal_update_cfg_req_msg msg_body, *body;
@@ -2145,28 +3407,27 @@ out:
 
 int wcn36xx_smd_set_mc_list(struct wcn36xx *wcn,
 			    struct ieee80211_vif *vif,
-			    struct wcn36xx_hal_rcv_flt_mc_addr_list_type *fp)
+			    const struct wcn36xx_mc_list *list)
 {
 	struct wcn36xx_vif *vif_priv = wcn36xx_vif_to_priv(vif);
 	struct wcn36xx_hal_rcv_flt_pkt_set_mc_list_req_msg *msg_body = NULL;
 	int ret = 0;
 
 	mutex_lock(&wcn->hal_mutex);
-
-	msg_body = (struct wcn36xx_hal_rcv_flt_pkt_set_mc_list_req_msg *)
-		   wcn->hal_buf;
-	init_hal_msg(&msg_body->header, WCN36XX_HAL_8023_MULTICAST_LIST_REQ,
-		     sizeof(msg_body->mc_addr_list));
+	INIT_HAL_BUF_MSG(wcn, msg_body, WCN36XX_HAL_8023_MULTICAST_LIST_REQ);
 
 	/* An empty list means all mc traffic will be received */
-	if (fp)
-		memcpy(&msg_body->mc_addr_list, fp,
-		       sizeof(msg_body->mc_addr_list));
-	else
-		msg_body->mc_addr_list.mc_addr_count = 0;
+	if (list) {
+		msg_body->mc_addr_list.mc_addr_count = list->count;
+		memcpy(msg_body->mc_addr_list.mc_addr, list->addr,
+		       list->count * ETH_ALEN);
+	}
 
 	msg_body->mc_addr_list.bss_index = vif_priv->bss_index;
 
+	wcn36xx_dbg(WCN36XX_DBG_HAL, "hal set mc list bss %d count %d\n",
+		    vif_priv->bss_index, msg_body->mc_addr_list.mc_addr_count);
+
 	ret = wcn36xx_smd_send_and_wait(wcn, msg_body->header.len);
 	if (ret) {
 		wcn36xx_err("Sending HAL_8023_MULTICAST_LIST failed\n");
@@ -2182,56 +3443,464 @@ out:
 	return ret;
 }
 
+int wcn36xx_smd_set_packet_filter(struct wcn36xx *wcn,
+				  struct ieee80211_vif *vif, u8 id,
+				  const struct wcn36xx_pkt_filter *filter)
+{
+	struct wcn36xx_hal_set_sessionized_rcv_pkt_filter_req_msg *msg_body;
+	struct wcn36xx_hal_set_rcv_pkt_filter_req_msg *legacy;
+	struct wcn36xx_vif *vif_priv = wcn36xx_vif_to_priv(vif);
+	struct wcn36xx_hal_rcv_pkt_filter_params *params;
+	size_t params_len = filter->params_count * sizeof(*params);
+	u32 len;
+	int ret;
+
+	if (!filter->params_count)
+		return -EINVAL;
+
+	mutex_lock(&wcn->hal_mutex);
+
+	/* Both layouts end with params[1], extended in place */
+	if (get_feat_caps(wcn->fw_feat_caps, SLM_SESSIONIZATION)) {
+		INIT_HAL_BUF_MSG(wcn, msg_body,
+				 WCN36XX_HAL_SET_PACKET_FILTER_REQ);
+		msg_body->cfg.id = id;
+		msg_body->cfg.type = filter->type;
+		msg_body->cfg.params_count = filter->params_count;
+		msg_body->cfg.bss_index = vif_priv->bss_index;
+		params = msg_body->cfg.params;
+		msg_body->header.len += params_len - sizeof(*params);
+		len = msg_body->header.len;
+	} else {
+		INIT_HAL_BUF_MSG(wcn, legacy,
+				 WCN36XX_HAL_SET_PACKET_FILTER_REQ);
+		legacy->id = id;
+		legacy->type = filter->type;
+		legacy->params_count = filter->params_count;
+		params = legacy->params;
+		legacy->header.len += params_len - sizeof(*params);
+		len = legacy->header.len;
+	}
+	memcpy(params, filter->params, params_len);
+
+	wcn36xx_dbg(WCN36XX_DBG_HAL,
+		    "hal set packet filter id %d type %d params %d bss %d\n",
+		    id, filter->type, filter->params_count,
+		    vif_priv->bss_index);
+
+	ret = wcn36xx_smd_send_and_wait(wcn, len);
+	if (ret) {
+		wcn36xx_err("Sending hal_set_packet_filter failed\n");
+		goto out;
+	}
+	ret = wcn36xx_smd_rsp_status_check(wcn->hal_buf, wcn->hal_rsp_len);
+	if (ret) {
+		wcn36xx_err("hal_set_packet_filter response failed err=%d\n",
+			    ret);
+		goto out;
+	}
+out:
+	mutex_unlock(&wcn->hal_mutex);
+	return ret;
+}
+
+static int wcn36xx_smd_packet_filter_match_count_rsp(struct wcn36xx *wcn,
+						     void *buf, size_t len)
+{
+	struct wcn36xx_hal_rcv_flt_pkt_match_cnt_rsp_msg *rsp = buf;
+	struct wcn36xx_hal_rcv_flt_pkt_match_cnt *match;
+	u32 i, count;
+
+	if (len < offsetof(typeof(*rsp), matches))
+		return -EIO;
+	if (rsp->status != WCN36XX_FW_MSG_RESULT_SUCCESS)
+		return rsp->status;
+
+	count = min_t(u32, rsp->match_count, WCN36XX_HAL_MAX_NUM_FILTERS);
+	if (len < offsetof(typeof(*rsp), matches) + count * sizeof(*match))
+		return -EIO;
+
+	for (i = 0; i < count; i++) {
+		match = &rsp->matches[i];
+		if (match->id < WCN36XX_HAL_MAX_NUM_FILTERS)
+			wcn->pkt_filters[match->id].match_cnt =
+				match->match_cnt;
+	}
+	return 0;
+}
+
+int wcn36xx_smd_packet_filter_match_count(struct wcn36xx *wcn,
+					  struct ieee80211_vif *vif)
+{
+	struct wcn36xx_hal_rcv_flt_pkt_match_cnt_req_msg msg_body;
+	struct wcn36xx_vif *vif_priv = wcn36xx_vif_to_priv(vif);
+	int ret;
+
+	mutex_lock(&wcn->hal_mutex);
+	INIT_HAL_MSG(msg_body, WCN36XX_HAL_PACKET_FILTER_MATCH_COUNT_REQ);
+
+	msg_body.bss_index = vif_priv->bss_index;
+
+	PREPARE_HAL_BUF(wcn->hal_buf, msg_body);
+
+	ret = wcn36xx_smd_send_and_wait(wcn, msg_body.header.len);
+	if (ret) {
+		wcn36xx_err("Sending hal_packet_filter_match_count failed\n");
+		goto out;
+	}
+	ret = wcn36xx_smd_packet_filter_match_count_rsp(wcn, wcn->hal_buf,
+							wcn->hal_rsp_len);
+	if (ret) {
+		wcn36xx_err("hal_packet_filter_match_count response failed err=%d\n",
+			    ret);
+		goto out;
+	}
+out:
+	mutex_unlock(&wcn->hal_mutex);
+	return ret;
+}
+
+int wcn36xx_smd_clear_packet_filter(struct wcn36xx *wcn,
+				    struct ieee80211_vif *vif, u8 id)
+{
+	struct wcn36xx_hal_rcv_flt_pkt_clear_req_msg msg_body;
+	struct wcn36xx_vif *vif_priv = wcn36xx_vif_to_priv(vif);
+	int ret;
+
+	mutex_lock(&wcn->hal_mutex);
+	INIT_HAL_MSG(msg_body, WCN36XX_HAL_CLEAR_PACKET_FILTER_REQ);
+
+	msg_body.param.id = id;
+	msg_body.param.bss_index = vif_priv->bss_index;
+
+	PREPARE_HAL_BUF(wcn->hal_buf, msg_body);
+
+	wcn36xx_dbg(WCN36XX_DBG_HAL, "hal clear packet filter id %d\n", id);
+
+	ret = wcn36xx_smd_send_and_wait(wcn, msg_body.header.len);
+	if (ret) {
+		wcn36xx_err("Sending hal_clear_packet_filter failed\n");
+		goto out;
+	}
+	ret = wcn36xx_smd_rsp_status_check(wcn->hal_buf, wcn->hal_rsp_len);
+	if (ret) {
+		wcn36xx_err("hal_clear_packet_filter response failed err=%d\n",
+			    ret);
+		goto out;
+	}
+out:
+	mutex_unlock(&wcn->hal_mutex);
+	return ret;
+}
+
+/* Copy the next stats category of a GET_STATS response if it is present */
+static int wcn36xx_smd_stats_block(u32 mask, u32 category, void *dst,
+				   size_t size, u8 **data, size_t *len)
+{
+	if (!(mask & category))
+		return 0;
+	if (*len < size)
+		return -EIO;
+
+	memcpy(dst, *data, size);
+	*data += size;
+	*len -= size;
+	return 0;
+}
+
+static int wcn36xx_smd_get_stats_rsp(void *buf, size_t len,
+				     struct wcn36xx_fw_stats *stats)
+{
+	struct wcn36xx_hal_stats_rsp_msg *rsp;
+	u8 *data;
+	int ret;
+
+	if (len < sizeof(*rsp))
+		return -EIO;
+
+	rsp = (struct wcn36xx_hal_stats_rsp_msg *)buf;
+	if (rsp->status != WCN36XX_FW_MSG_RESULT_SUCCESS)
+		return rsp->status;
+
+	/* Categories follow the header in the order of their mask bits */
+	if (rsp->stats_mask & ~WCN36XX_FW_STATS_MASK)
+		return -EIO;
+
+	data = (u8 *)buf + sizeof(*rsp);
+	len -= sizeof(*rsp);
+
+	ret = wcn36xx_smd_stats_block(rsp->stats_mask, HAL_SUMMARY_STATS_INFO,
+				      &stats->summary, sizeof(stats->summary),
+				      &data, &len);
+	if (ret)
+		return ret;
+	ret = wcn36xx_smd_stats_block(rsp->stats_mask,
+				      HAL_GLOBAL_CLASS_A_STATS_INFO,
+				      &stats->class_a, sizeof(stats->class_a),
+				      &data, &len);
+	if (ret)
+		return ret;
+	ret = wcn36xx_smd_stats_block(rsp->stats_mask, HAL_PER_STA_STATS_INFO,
+				      &stats->per_sta, sizeof(stats->per_sta),
+				      &data, &len);
+	if (ret)
+		return ret;
+
+	stats->mask = rsp->stats_mask;
+	return 0;
+}
+
+int wcn36xx_smd_get_stats(struct wcn36xx *wcn, u8 sta_index,
+			  struct wcn36xx_fw_stats *stats)
+{
+	struct wcn36xx_hal_stats_req_msg msg_body;
+	int ret;
+
+	mutex_lock(&wcn->hal_mutex);
+	INIT_HAL_MSG(msg_body, WCN36XX_HAL_GET_STATS_REQ);
+
+	msg_body.sta_id = sta_index;
+	msg_body.stats_mask = WCN36XX_FW_STATS_MASK;
+
+	PREPARE_HAL_BUF(wcn->hal_buf, msg_body);
+
+	wcn36xx_dbg(WCN36XX_DBG_HAL, "hal get stats sta_index %d mask 0x%x\n",
+		    msg_body.sta_id, msg_body.stats_mask);
+
+	ret = wcn36xx_smd_send_and_wait(wcn, msg_body.header.len);
+	if (ret) {
+		wcn36xx_err("Sending hal_get_stats failed\n");
+		goto out;
+	}
+	ret = wcn36xx_smd_get_stats_rsp(wcn->hal_buf, wcn->hal_rsp_len, stats);
+	if (ret) {
+		wcn36xx_err("hal_get_stats response failed err=%d\n", ret);
+		goto out;
+	}
+out:
+	mutex_unlock(&wcn->hal_mutex);
+	return ret;
+}
+
+enum wcn36xx_hal_msg_kind {
+	WCN36XX_HAL_MSG_UNKNOWN = 0,
+	WCN36XX_HAL_MSG_REQ,
+	WCN36XX_HAL_MSG_RSP,
+	WCN36XX_HAL_MSG_IND,
+};
+
+/**
+ * struct wcn36xx_hal_msg_desc - entry of the HAL message dispatch table
+ *
+ * @name: message name without the WCN36XX_HAL_ prefix.
+ * @kind: whether the message is a request, a response or an indication.
+ * Messages with kind WCN36XX_HAL_MSG_UNKNOWN are not supported.
+ * @req: for responses, the request they answer.
+ * @timeout_floor: for requests, lower bound of the adaptive timeout in ms.
+ * @ind_handler: handler called from the indication work for indications.
+ */
+struct wcn36xx_hal_msg_desc {
+	const char *name;
+	enum wcn36xx_hal_msg_kind kind;
+	enum wcn36xx_hal_host_msg_type req;
+	unsigned int timeout_floor;
+	int (*ind_handler)(struct wcn36xx *wcn, void *buf, size_t len);
+};
+
+#define HAL_REQ(type)							\
+	[WCN36XX_HAL_ ## type] = {					\
+		.name = #type,						\
+		.kind = WCN36XX_HAL_MSG_REQ,				\
+	}
+#define HAL_SLOW_REQ(type, floor)					\
+	[WCN36XX_HAL_ ## type] = {					\
+		.name = #type,						\
+		.kind = WCN36XX_HAL_MSG_REQ,				\
+		.timeout_floor = floor,					\
+	}
+#define HAL_RSP(type, request)						\
+	[WCN36XX_HAL_ ## type] = {					\
+		.name = #type,						\
+		.kind = WCN36XX_HAL_MSG_RSP,				\
+		.req = WCN36XX_HAL_ ## request,				\
+	}
+#define HAL_IND(type, handler)						\
+	[WCN36XX_HAL_ ## type] = {					\
+		.name = #type,						\
+		.kind = WCN36XX_HAL_MSG_IND,				\
+		.ind_handler = handler,					\
+	}
+
+static const struct wcn36xx_hal_msg_desc wcn36xx_hal_msgs[WCN36XX_HAL_MSG_NUM] = {
+	HAL_SLOW_REQ(START_REQ, HAL_MSG_TIMEOUT),
+	HAL_RSP(START_RSP, START_REQ),
+	HAL_REQ(STOP_REQ),
+	HAL_RSP(STOP_RSP, STOP_REQ),
+	HAL_SLOW_REQ(INIT_SCAN_REQ, 200),
+	HAL_RSP(INIT_SCAN_RSP, INIT_SCAN_REQ),
+	HAL_REQ(START_SCAN_REQ),
+	HAL_RSP(START_SCAN_RSP, START_SCAN_REQ),
+	HAL_REQ(END_SCAN_REQ),
+	HAL_RSP(END_SCAN_RSP, END_SCAN_REQ),
+	HAL_SLOW_REQ(FINISH_SCAN_REQ, 200),
+	HAL_RSP(FINISH_SCAN_RSP, FINISH_SCAN_REQ),
+	HAL_REQ(CONFIG_STA_REQ),
+	HAL_RSP(CONFIG_STA_RSP, CONFIG_STA_REQ),
+	HAL_REQ(DELETE_STA_REQ),
+	HAL_RSP(DELETE_STA_RSP, DELETE_STA_REQ),
+	HAL_REQ(CONFIG_BSS_REQ),
+	HAL_RSP(CONFIG_BSS_RSP, CONFIG_BSS_REQ),
+	HAL_REQ(DELETE_BSS_REQ),
+	HAL_RSP(DELETE_BSS_RSP, DELETE_BSS_REQ),
+	HAL_SLOW_REQ(JOIN_REQ, 200),
+	HAL_RSP(JOIN_RSP, JOIN_REQ),
+	HAL_REQ(SET_BSSKEY_REQ),
+	HAL_RSP(SET_BSSKEY_RSP, SET_BSSKEY_REQ),
+	HAL_REQ(SET_STAKEY_REQ),
+	HAL_RSP(SET_STAKEY_RSP, SET_STAKEY_REQ),
+	HAL_REQ(RMV_BSSKEY_REQ),
+	HAL_RSP(RMV_BSSKEY_RSP, RMV_BSSKEY_REQ),
+	HAL_REQ(RMV_STAKEY_REQ),
+	HAL_RSP(RMV_STAKEY_RSP, RMV_STAKEY_REQ),
+	HAL_REQ(ADD_BA_REQ),
+	HAL_RSP(ADD_BA_RSP, ADD_BA_REQ),
+	HAL_REQ(DEL_BA_REQ),
+	HAL_RSP(DEL_BA_RSP, DEL_BA_REQ),
+	HAL_REQ(CH_SWITCH_REQ),
+	HAL_RSP(CH_SWITCH_RSP, CH_SWITCH_REQ),
+	HAL_REQ(SET_LINK_ST_REQ),
+	HAL_RSP(SET_LINK_ST_RSP, SET_LINK_ST_REQ),
+	HAL_REQ(ADD_TS_REQ),
+	HAL_RSP(ADD_TS_RSP, ADD_TS_REQ),
+	HAL_REQ(DEL_TS_REQ),
+	HAL_RSP(DEL_TS_RSP, DEL_TS_REQ),
+	HAL_REQ(GET_STATS_REQ),
+	HAL_RSP(GET_STATS_RSP, GET_STATS_REQ),
+	HAL_REQ(UPD_EDCA_PARAMS_REQ),
+	HAL_RSP(UPD_EDCA_PARAMS_RSP, UPD_EDCA_PARAMS_REQ),
+	HAL_REQ(UPDATE_CFG_REQ),
+	HAL_RSP(UPDATE_CFG_RSP, UPDATE_CFG_REQ),
+	HAL_IND(MISSED_BEACON_IND, wcn36xx_smd_missed_beacon_ind),
+	HAL_SLOW_REQ(DOWNLOAD_NV_REQ, HAL_MSG_TIMEOUT),
+	HAL_RSP(DOWNLOAD_NV_RSP, DOWNLOAD_NV_REQ),
+	HAL_REQ(ADD_BA_SESSION_REQ),
+	HAL_RSP(ADD_BA_SESSION_RSP, ADD_BA_SESSION_REQ),
+	HAL_REQ(TRIGGER_BA_REQ),
+	HAL_RSP(TRIGGER_BA_RSP, TRIGGER_BA_REQ),
+	HAL_IND(DEL_BA_IND, wcn36xx_smd_del_ba_ind),
+	HAL_REQ(SEND_BEACON_REQ),
+	HAL_RSP(SEND_BEACON_RSP, SEND_BEACON_REQ),
+	HAL_IND(DELETE_STA_CONTEXT_IND, wcn36xx_smd_delete_sta_context_ind),
+	HAL_REQ(UPDATE_PROBE_RSP_TEMPLATE_REQ),
+	HAL_RSP(UPDATE_PROBE_RSP_TEMPLATE_RSP,
+		UPDATE_PROBE_RSP_TEMPLATE_REQ),
+	HAL_REQ(ENTER_BMPS_REQ),
+	HAL_REQ(EXIT_BMPS_REQ),
+	HAL_RSP(ENTER_BMPS_RSP, ENTER_BMPS_REQ),
+	HAL_RSP(EXIT_BMPS_RSP, EXIT_BMPS_REQ),
+	HAL_REQ(ENTER_UAPSD_REQ),
+	HAL_RSP(ENTER_UAPSD_RSP, ENTER_UAPSD_REQ),
+	HAL_REQ(EXIT_UAPSD_REQ),
+	HAL_RSP(EXIT_UAPSD_RSP, EXIT_UAPSD_REQ),
+	HAL_REQ(UPDATE_UAPSD_PARAM_REQ),
+	HAL_RSP(UPDATE_UAPSD_PARAM_RSP, UPDATE_UAPSD_PARAM_REQ),
+	HAL_REQ(SET_UAPSD_AC_PARAMS_REQ),
+	HAL_RSP(SET_UAPSD_AC_PARAMS_RSP, SET_UAPSD_AC_PARAMS_REQ),
+	HAL_REQ(ADD_BCN_FILTER_REQ),
+	HAL_RSP(ADD_BCN_FILTER_RSP, ADD_BCN_FILTER_REQ),
+	HAL_REQ(REM_BCN_FILTER_REQ),
+	HAL_RSP(REM_BCN_FILTER_RSP, REM_BCN_FILTER_REQ),
+	HAL_REQ(SET_RSSI_THRESH_REQ),
+	HAL_RSP(SET_RSSI_THRESH_RSP, SET_RSSI_THRESH_REQ),
+	HAL_IND(RSSI_NOTIFICATION_IND, wcn36xx_smd_rssi_notification_ind),
+	HAL_REQ(HOST_OFFLOAD_REQ),
+	HAL_RSP(HOST_OFFLOAD_RSP, HOST_OFFLOAD_REQ),
+	HAL_REQ(GTK_OFFLOAD_REQ),
+	HAL_RSP(GTK_OFFLOAD_RSP, GTK_OFFLOAD_REQ),
+	HAL_REQ(GTK_OFFLOAD_GETINFO_REQ),
+	HAL_RSP(GTK_OFFLOAD_GETINFO_RSP, GTK_OFFLOAD_GETINFO_REQ),
+	HAL_REQ(SET_PACKET_FILTER_REQ),
+	HAL_RSP(SET_PACKET_FILTER_RSP, SET_PACKET_FILTER_REQ),
+	HAL_REQ(PACKET_FILTER_MATCH_COUNT_REQ),
+	HAL_RSP(PACKET_FILTER_MATCH_COUNT_RSP, PACKET_FILTER_MATCH_COUNT_REQ),
+	HAL_REQ(CLEAR_PACKET_FILTER_REQ),
+	HAL_RSP(CLEAR_PACKET_FILTER_RSP, CLEAR_PACKET_FILTER_REQ),
+	HAL_REQ(DUMP_COMMAND_REQ),
+	HAL_RSP(DUMP_COMMAND_RSP, DUMP_COMMAND_REQ),
+	HAL_REQ(ADD_STA_SELF_REQ),
+	HAL_RSP(ADD_STA_SELF_RSP, ADD_STA_SELF_REQ),
+	HAL_REQ(DEL_STA_SELF_REQ),
+	HAL_RSP(DEL_STA_SELF_RSP, DEL_STA_SELF_REQ),
+	HAL_IND(OTA_TX_COMPL_IND, wcn36xx_smd_tx_compl_ind),
+	HAL_REQ(KEEP_ALIVE_REQ),
+	HAL_RSP(KEEP_ALIVE_RSP, KEEP_ALIVE_REQ),
+	HAL_REQ(UPDATE_SCAN_PARAM_REQ),
+	HAL_RSP(UPDATE_SCAN_PARAM_RSP, UPDATE_SCAN_PARAM_REQ),
+	HAL_REQ(8023_MULTICAST_LIST_REQ),
+	HAL_RSP(8023_MULTICAST_LIST_RSP, 8023_MULTICAST_LIST_REQ),
+	HAL_REQ(SET_POWER_PARAMS_REQ),
+	HAL_RSP(SET_POWER_PARAMS_RSP, SET_POWER_PARAMS_REQ),
+	HAL_REQ(FEATURE_CAPS_EXCHANGE_REQ),
+	HAL_RSP(FEATURE_CAPS_EXCHANGE_RSP, FEATURE_CAPS_EXCHANGE_REQ),
+	HAL_REQ(START_SCAN_OFFLOAD_REQ),
+	HAL_RSP(START_SCAN_OFFLOAD_RSP, START_SCAN_OFFLOAD_REQ),
+	HAL_REQ(STOP_SCAN_OFFLOAD_REQ),
+	HAL_RSP(STOP_SCAN_OFFLOAD_RSP, STOP_SCAN_OFFLOAD_REQ),
+	HAL_IND(SCAN_OFFLOAD_IND, wcn36xx_smd_hw_scan_ind),
+	HAL_REQ(SET_PREF_NETWORK_REQ),
+	HAL_RSP(SET_PREF_NETWORK_RSP, SET_PREF_NETWORK_REQ),
+	HAL_IND(PREF_NETW_FOUND_IND, wcn36xx_smd_pref_netw_found_ind),
+};
+
+static const struct wcn36xx_hal_msg_desc *
+wcn36xx_smd_msg_desc(enum wcn36xx_hal_host_msg_type msg_type)
+{
+	if (msg_type >= WCN36XX_HAL_MSG_NUM)
+		return NULL;
+	if (wcn36xx_hal_msgs[msg_type].kind == WCN36XX_HAL_MSG_UNKNOWN)
+		return NULL;
+	return &wcn36xx_hal_msgs[msg_type];
+}
+
+const char *wcn36xx_smd_msg_name(enum wcn36xx_hal_host_msg_type msg_type)
+{
+	const struct wcn36xx_hal_msg_desc *desc = wcn36xx_smd_msg_desc(msg_type);
+
+	return desc ? desc->name : "UNKNOWN";
+}
+
 static void wcn36xx_smd_rsp_process(struct wcn36xx *wcn, void *buf, size_t len)
 {
 	struct wcn36xx_hal_msg_header *msg_header = buf;
+	const struct wcn36xx_hal_msg_desc *desc;
 	struct wcn36xx_hal_ind_msg *msg_ind;
 	wcn36xx_dbg_dump(WCN36XX_DBG_SMD_DUMP, "SMD <<< ", buf, len);
 
-	switch (msg_header->msg_type) {
-	case WCN36XX_HAL_START_RSP:
-	case WCN36XX_HAL_CONFIG_STA_RSP:
-	case WCN36XX_HAL_CONFIG_BSS_RSP:
-	case WCN36XX_HAL_ADD_STA_SELF_RSP:
-	case WCN36XX_HAL_STOP_RSP:
-	case WCN36XX_HAL_DEL_STA_SELF_RSP:
-	case WCN36XX_HAL_DELETE_STA_RSP:
-	case WCN36XX_HAL_INIT_SCAN_RSP:
-	case WCN36XX_HAL_START_SCAN_RSP:
-	case WCN36XX_HAL_END_SCAN_RSP:
-	case WCN36XX_HAL_FINISH_SCAN_RSP:
-	case WCN36XX_HAL_DOWNLOAD_NV_RSP:
-	case WCN36XX_HAL_DELETE_BSS_RSP:
-	case WCN36XX_HAL_SEND_BEACON_RSP:
-	case WCN36XX_HAL_SET_LINK_ST_RSP:
-	case WCN36XX_HAL_UPDATE_PROBE_RSP_TEMPLATE_RSP:
-	case WCN36XX_HAL_SET_BSSKEY_RSP:
-	case WCN36XX_HAL_SET_STAKEY_RSP:
-	case WCN36XX_HAL_RMV_STAKEY_RSP:
-	case WCN36XX_HAL_RMV_BSSKEY_RSP:
-	case WCN36XX_HAL_ENTER_BMPS_RSP:
-	case WCN36XX_HAL_SET_POWER_PARAMS_RSP:
-	case WCN36XX_HAL_EXIT_BMPS_RSP:
-	case WCN36XX_HAL_KEEP_ALIVE_RSP:
-	case WCN36XX_HAL_DUMP_COMMAND_RSP:
-	case WCN36XX_HAL_ADD_BA_SESSION_RSP:
-	case WCN36XX_HAL_ADD_BA_RSP:
-	case WCN36XX_HAL_DEL_BA_RSP:
-	case WCN36XX_HAL_TRIGGER_BA_RSP:
-	case WCN36XX_HAL_UPDATE_CFG_RSP:
-	case WCN36XX_HAL_JOIN_RSP:
-	case WCN36XX_HAL_UPDATE_SCAN_PARAM_RSP:
-	case WCN36XX_HAL_CH_SWITCH_RSP:
-	case WCN36XX_HAL_FEATURE_CAPS_EXCHANGE_RSP:
-	case WCN36XX_HAL_8023_MULTICAST_LIST_RSP:
+	desc = wcn36xx_smd_msg_desc(msg_header->msg_type);
+	if (!desc || desc->kind == WCN36XX_HAL_MSG_REQ) {
+		wcn36xx_err("SMD_EVENT (%d) not supported\n",
+			      msg_header->msg_type);
+		return;
+	}
+
+	wcn36xx_smd_stats_account(wcn, msg_header->msg_type, len);
+
+	switch (desc->kind) {
+	case WCN36XX_HAL_MSG_RSP:
+		spin_lock(&wcn->hal_rsp_lock);
+		if (!wcn->hal_req_pending || wcn->hal_req_type != desc->req) {
+			spin_unlock(&wcn->hal_rsp_lock);
+			wcn36xx_warn("Dropping stale %s\n", desc->name);
+			break;
+		}
 		memcpy(wcn->hal_buf, buf, len);
 		wcn->hal_rsp_len = len;
+		wcn->hal_req_pending = false;
 		complete(&wcn->hal_rsp_compl);
+		spin_unlock(&wcn->hal_rsp_lock);
 		break;
 
-	case WCN36XX_HAL_OTA_TX_COMPL_IND:
-	case WCN36XX_HAL_MISSED_BEACON_IND:
-	case WCN36XX_HAL_DELETE_STA_CONTEXT_IND:
+	case WCN36XX_HAL_MSG_IND:
 		msg_ind = kmalloc(sizeof(*msg_ind), GFP_KERNEL);
 		if (!msg_ind)
 			goto nomem;
@@ -2253,11 +3922,11 @@ nomem:
 		list_add_tail(&msg_ind->list, &wcn->hal_ind_queue);
 		queue_work(wcn->hal_ind_wq, &wcn->hal_ind_work);
 		mutex_unlock(&wcn->hal_ind_mutex);
-		wcn36xx_dbg(WCN36XX_DBG_HAL, "indication arrived\n");
+		wcn36xx_dbg(WCN36XX_DBG_HAL, "indication %s arrived\n",
+			    desc->name);
 		break;
 	default:
-		wcn36xx_err("SMD_EVENT (%d) not supported\n",
-			      msg_header->msg_type);
+		break;
 	}
 }
 static void wcn36xx_ind_smd_work(struct work_struct *work)
@@ -2266,6 +3935,7 @@ static void wcn36xx_ind_smd_work(struct work_struct *work)
 		container_of(work, struct wcn36xx, hal_ind_work);
 	struct wcn36xx_hal_msg_header *msg_header;
 	struct wcn36xx_hal_ind_msg *hal_ind_msg;
+	const struct wcn36xx_hal_msg_desc *desc;
 
 	mutex_lock(&wcn->hal_ind_mutex);
 
@@ -2275,26 +3945,13 @@ static void wcn36xx_ind_smd_work(struct work_struct *work)
 
 	msg_header = (struct wcn36xx_hal_msg_header *)hal_ind_msg->msg;
 
-	switch (msg_header->msg_type) {
-	case WCN36XX_HAL_OTA_TX_COMPL_IND:
-		wcn36xx_smd_tx_compl_ind(wcn,
-					 hal_ind_msg->msg,
-					 hal_ind_msg->msg_len);
-		break;
-	case WCN36XX_HAL_MISSED_BEACON_IND:
-		wcn36xx_smd_missed_beacon_ind(wcn,
-					      hal_ind_msg->msg,
-					      hal_ind_msg->msg_len);
-		break;
-	case WCN36XX_HAL_DELETE_STA_CONTEXT_IND:
-		wcn36xx_smd_delete_sta_context_ind(wcn,
-						   hal_ind_msg->msg,
-						   hal_ind_msg->msg_len);
-		break;
-	default:
+	desc = wcn36xx_smd_msg_desc(msg_header->msg_type);
+	if (desc && desc->ind_handler)
+		desc->ind_handler(wcn, hal_ind_msg->msg, hal_ind_msg->msg_len);
+	else
 		wcn36xx_err("SMD_EVENT (%d) not supported\n",
 			      msg_header->msg_type);
-	}
+
 	list_del(wcn->hal_ind_queue.next);
 	kfree(hal_ind_msg->msg);
 	kfree(hal_ind_msg);
@@ -26,6 +26,18 @@
 #define WCN36XX_HAL_BUF_SIZE				4096
 
 #define HAL_MSG_TIMEOUT 500
+
+/* Channel dwell times in ms, same as the mac80211 software scan */
+#define WCN36XX_SCAN_ACTIVE_DWELL	30
+#define WCN36XX_SCAN_PASSIVE_DWELL	110
+
+/* Lower bound for adaptive HAL timeouts in ms */
+#define WCN36XX_HAL_TIMEOUT_FLOOR			50
+/* Adaptive timeout is this many times the observed p99 latency */
+#define WCN36XX_HAL_TIMEOUT_MARGIN			4
+/* Samples needed before the timeout of a message type is adapted */
+#define WCN36XX_HAL_TIMEOUT_MIN_SAMPLES			32
+
 #define WCN36XX_SMSM_WLAN_TX_ENABLE			0x00000400
 #define WCN36XX_SMSM_WLAN_TX_RINGS_EMPTY		0x00000200
 /* The PNO version info be contained in the rsp msg */
@@ -55,16 +67,35 @@ struct wcn36xx;
 
 int wcn36xx_smd_open(struct wcn36xx *wcn);
 void wcn36xx_smd_close(struct wcn36xx *wcn);
+const char *wcn36xx_smd_msg_name(enum wcn36xx_hal_host_msg_type msg_type);
+void wcn36xx_smd_stats_get(struct wcn36xx *wcn,
+			   enum wcn36xx_hal_host_msg_type msg_type,
+			   struct wcn36xx_hal_msg_stats *stats);
+void wcn36xx_smd_stats_reset(struct wcn36xx *wcn);
+u32 wcn36xx_smd_lat_percentile(struct wcn36xx_hal_msg_stats *stats, int pct);
+unsigned int wcn36xx_smd_timeout(struct wcn36xx *wcn,
+				 enum wcn36xx_hal_host_msg_type msg_type);
 
 int wcn36xx_smd_load_nv(struct wcn36xx *wcn);
 int wcn36xx_smd_start(struct wcn36xx *wcn);
 int wcn36xx_smd_stop(struct wcn36xx *wcn);
-int wcn36xx_smd_init_scan(struct wcn36xx *wcn, enum wcn36xx_hal_sys_mode mode);
-int wcn36xx_smd_start_scan(struct wcn36xx *wcn);
-int wcn36xx_smd_end_scan(struct wcn36xx *wcn);
+int wcn36xx_smd_init_scan(struct wcn36xx *wcn, enum wcn36xx_hal_sys_mode mode,
+			  struct ieee80211_vif *vif);
+int wcn36xx_smd_start_scan(struct wcn36xx *wcn, u8 scan_channel);
+int wcn36xx_smd_end_scan(struct wcn36xx *wcn, u8 scan_channel);
 int wcn36xx_smd_finish_scan(struct wcn36xx *wcn,
-			    enum wcn36xx_hal_sys_mode mode);
-int wcn36xx_smd_update_scan_params(struct wcn36xx *wcn);
+			    enum wcn36xx_hal_sys_mode mode,
+			    struct ieee80211_vif *vif);
+int wcn36xx_smd_update_scan_params(struct wcn36xx *wcn, u8 *channels,
+				   size_t channel_count);
+int wcn36xx_smd_set_pref_netw_list(struct wcn36xx *wcn,
+				   struct ieee80211_vif *vif,
+				   struct cfg80211_sched_scan_request *req,
+				   struct ieee80211_sched_scan_ies *ies);
+int wcn36xx_smd_stop_pno(struct wcn36xx *wcn);
+int wcn36xx_smd_start_hw_scan(struct wcn36xx *wcn, struct ieee80211_vif *vif,
+			      struct cfg80211_scan_request *req);
+int wcn36xx_smd_stop_hw_scan(struct wcn36xx *wcn);
 int wcn36xx_smd_add_sta_self(struct wcn36xx *wcn, struct ieee80211_vif *vif);
 int wcn36xx_smd_delete_sta_self(struct wcn36xx *wcn, u8 *addr);
 int wcn36xx_smd_delete_sta(struct wcn36xx *wcn, u8 sta_index);
@@ -106,6 +137,26 @@ int wcn36xx_smd_remove_bsskey(struct wcn36xx *wcn,
 			      u8 keyidx);
 int wcn36xx_smd_enter_bmps(struct wcn36xx *wcn, struct ieee80211_vif *vif);
 int wcn36xx_smd_exit_bmps(struct wcn36xx *wcn, struct ieee80211_vif *vif);
+int wcn36xx_smd_enter_uapsd(struct wcn36xx *wcn, struct ieee80211_vif *vif);
+int wcn36xx_smd_exit_uapsd(struct wcn36xx *wcn, struct ieee80211_vif *vif);
+int wcn36xx_smd_update_uapsd_params(struct wcn36xx *wcn,
+				    struct ieee80211_vif *vif,
+				    u8 sta_index);
+int wcn36xx_smd_update_edca_params(struct wcn36xx *wcn,
+				   struct ieee80211_vif *vif);
+int wcn36xx_smd_set_uapsd_ac_params(struct wcn36xx *wcn, u8 sta_index,
+				    u16 ac, u32 service_interval);
+int wcn36xx_smd_add_bcn_filter(struct wcn36xx *wcn, struct ieee80211_vif *vif);
+int wcn36xx_smd_rem_bcn_filter(struct wcn36xx *wcn);
+int wcn36xx_smd_set_rssi_thresh(struct wcn36xx *wcn, s32 thold, u32 hyst);
+int wcn36xx_smd_arp_offload(struct wcn36xx *wcn, struct ieee80211_vif *vif,
+			    __be32 addr);
+int wcn36xx_smd_ns_offload(struct wcn36xx *wcn, struct ieee80211_vif *vif,
+			   const struct in6_addr *addrs, int count);
+int wcn36xx_smd_gtk_offload(struct wcn36xx *wcn, struct ieee80211_vif *vif,
+			    bool enable);
+int wcn36xx_smd_gtk_offload_get_info(struct wcn36xx *wcn,
+				     struct ieee80211_vif *vif);
 int wcn36xx_smd_set_power_params(struct wcn36xx *wcn, bool ignore_dtim);
 int wcn36xx_smd_keep_alive_req(struct wcn36xx *wcn,
 			       struct ieee80211_vif *vif,
@@ -122,13 +173,26 @@ int wcn36xx_smd_add_ba_session(struct wcn36xx *wcn,
 		u16 tid,
 		u16 *ssn,
 		u8 direction,
-		u8 sta_index);
-int wcn36xx_smd_add_ba(struct wcn36xx *wcn);
-int wcn36xx_smd_del_ba(struct wcn36xx *wcn, u16 tid, u8 sta_index);
-int wcn36xx_smd_trigger_ba(struct wcn36xx *wcn, u8 sta_index);
+		u8 sta_index,
+		u16 buf_size,
+		u16 timeout);
+int wcn36xx_smd_add_ba(struct wcn36xx *wcn, u8 session_id, u8 win_size);
+int wcn36xx_smd_del_ba(struct wcn36xx *wcn, u16 tid, u8 direction,
+		       u8 sta_index);
+int wcn36xx_smd_trigger_ba(struct wcn36xx *wcn, u8 sta_index, u8 session_id,
+			   u8 tid_bitmap);
 
 int wcn36xx_smd_update_cfg(struct wcn36xx *wcn, u32 cfg_id, u32 value);
 int wcn36xx_smd_set_mc_list(struct wcn36xx *wcn,
 			    struct ieee80211_vif *vif,
-			    struct wcn36xx_hal_rcv_flt_mc_addr_list_type *fp);
+			    const struct wcn36xx_mc_list *list);
+int wcn36xx_smd_set_packet_filter(struct wcn36xx *wcn,
+				  struct ieee80211_vif *vif, u8 id,
+				  const struct wcn36xx_pkt_filter *filter);
+int wcn36xx_smd_packet_filter_match_count(struct wcn36xx *wcn,
+					  struct ieee80211_vif *vif);
+int wcn36xx_smd_clear_packet_filter(struct wcn36xx *wcn,
+				    struct ieee80211_vif *vif, u8 id);
+int wcn36xx_smd_get_stats(struct wcn36xx *wcn, u8 sta_index,
+			  struct wcn36xx_fw_stats *stats);
 #endif	/* _SMD_H_ */
@@ -17,13 +17,365 @@
 
 #define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
 
+#include <linux/module.h>
+#include <linux/if_arp.h>
+#include <linux/ipv6.h>
+#include <net/ipv6.h>
+#include <net/ndisc.h>
 #include "txrx.h"
 
+static unsigned int ampdu_min_pps = 50;
+module_param(ampdu_min_pps, uint, 0644);
+MODULE_PARM_DESC(ampdu_min_pps,
+		 "QoS data frames per second on a TID before a-mpdu is started");
+
+static unsigned int ampdu_min_kbps = 256;
+module_param(ampdu_min_kbps, uint, 0644);
+MODULE_PARM_DESC(ampdu_min_kbps,
+		 "TX load in kbit/s on a TID before a-mpdu is started");
+
+static unsigned int ampdu_idle_tu = 5000;
+module_param(ampdu_idle_tu, uint, 0644);
+MODULE_PARM_DESC(ampdu_idle_tu,
+		 "Idle time in TU after which a TX a-mpdu session is torn down, 0 never");
+
+static unsigned int ampdu_max_sessions = 32;
+module_param(ampdu_max_sessions, uint, 0644);
+MODULE_PARM_DESC(ampdu_max_sessions,
+		 "Block-ack sessions in use above which no TX a-mpdu is started");
+
+static bool ampdu_vo;
+module_param(ampdu_vo, bool, 0644);
+MODULE_PARM_DESC(ampdu_vo, "Allow a-mpdu on the voice access category");
+
+static unsigned int amsdu_latency_us = 500;
+module_param(amsdu_latency_us, uint, 0644);
+MODULE_PARM_DESC(amsdu_latency_us,
+		 "Longest time in us a small frame is held to build a TX A-MSDU, 0 off");
+
 static inline int get_rssi0(struct wcn36xx_rx_bd *bd)
 {
 	return 100 - ((bd->phy_stat0 >> 24) & 0xff);
 }
 
+static inline int get_rssi1(struct wcn36xx_rx_bd *bd)
+{
+	return 100 - ((bd->phy_stat0 >> 16) & 0xff);
+}
+
+/* Rate a frame was received at, indexed by the BD rate_id */
+struct wcn36xx_rx_rate {
+	u8 idx;		/* legacy rate index in the 2.4GHz band, or HT MCS */
+	u32 flag;	/* RX_FLAG_HT, _40MHZ, _SHORT_GI, _HT_GF, _SHORTPRE */
+};
+
+#define RX_RATE(_idx, _flag) { .idx = (_idx), .flag = (_flag) }
+#define RX_RATE_HT(_flag) \
+	RX_RATE(0, RX_FLAG_HT | (_flag)), RX_RATE(1, RX_FLAG_HT | (_flag)), \
+	RX_RATE(2, RX_FLAG_HT | (_flag)), RX_RATE(3, RX_FLAG_HT | (_flag)), \
+	RX_RATE(4, RX_FLAG_HT | (_flag)), RX_RATE(5, RX_FLAG_HT | (_flag)), \
+	RX_RATE(6, RX_FLAG_HT | (_flag)), RX_RATE(7, RX_FLAG_HT | (_flag))
+
+static const struct wcn36xx_rx_rate wcn36xx_rx_rates[] = {
+	/* 11b long preamble */
+	RX_RATE(0, 0), RX_RATE(1, 0), RX_RATE(2, 0), RX_RATE(3, 0),
+	/* 11b short preamble */
+	RX_RATE(0, RX_FLAG_SHORTPRE), RX_RATE(1, RX_FLAG_SHORTPRE),
+	RX_RATE(2, RX_FLAG_SHORTPRE), RX_RATE(3, RX_FLAG_SHORTPRE),
+	/* 11a/g */
+	RX_RATE(4, 0), RX_RATE(5, 0), RX_RATE(6, 0), RX_RATE(7, 0),
+	RX_RATE(8, 0), RX_RATE(9, 0), RX_RATE(10, 0), RX_RATE(11, 0),
+	/* 11n 20MHz: long GI, short GI, greenfield */
+	RX_RATE_HT(0),
+	RX_RATE_HT(RX_FLAG_SHORT_GI),
+	RX_RATE_HT(RX_FLAG_HT_GF),
+	/* 11n 40MHz: long GI, short GI, greenfield */
+	RX_RATE_HT(RX_FLAG_40MHZ),
+	RX_RATE_HT(RX_FLAG_40MHZ | RX_FLAG_SHORT_GI),
+	RX_RATE_HT(RX_FLAG_40MHZ | RX_FLAG_HT_GF),
+};
+
+/* Number of 11b rates the 5GHz band table does not carry */
+#define WCN36XX_RX_CCK_RATES	4
+
+static void wcn36xx_rx_rate(struct wcn36xx_rx_bd *bd,
+			    struct ieee80211_rx_status *status)
+{
+	const struct wcn36xx_rx_rate *rate;
+
+	if (bd->rate_id >= ARRAY_SIZE(wcn36xx_rx_rates)) {
+		wcn36xx_dbg(WCN36XX_DBG_RX, "unknown rx rate_id %d\n",
+			    bd->rate_id);
+		return;
+	}
+
+	rate = &wcn36xx_rx_rates[bd->rate_id];
+	status->rate_idx = rate->idx;
+	status->flag |= rate->flag;
+
+	if (!(rate->flag & RX_FLAG_HT) && status->band == IEEE80211_BAND_5GHZ) {
+		if (rate->idx < WCN36XX_RX_CCK_RATES) {
+			/* No CCK on 5GHz, the BD must be bogus */
+			status->rate_idx = 0;
+			return;
+		}
+		status->rate_idx -= WCN36XX_RX_CCK_RATES;
+	}
+}
+
+/*
+ * RSSI of each receive chain. A chain that did not take part reports
+ * zero in the BD, which shows up as exactly 100 below the other chain.
+ */
+static void wcn36xx_rx_signal(struct wcn36xx_rx_bd *bd,
+			      struct ieee80211_rx_status *status)
+{
+	int rssi0 = -get_rssi0(bd);
+	int rssi1 = -get_rssi1(bd);
+
+	status->chains = BIT(0);
+	status->chain_signal[0] = rssi0;
+	status->signal = rssi0;
+
+	if ((bd->phy_stat0 >> 16) & 0xff) {
+		status->chains |= BIT(1);
+		status->chain_signal[1] = rssi1;
+		status->signal = max(rssi0, rssi1);
+	}
+}
+
+struct wcn36xx_pcpu_stats __percpu *wcn36xx_stats_alloc(void)
+{
+	struct wcn36xx_pcpu_stats __percpu *pcpu;
+	int cpu;
+
+	pcpu = alloc_percpu(struct wcn36xx_pcpu_stats);
+	if (!pcpu)
+		return NULL;
+
+	for_each_possible_cpu(cpu)
+		u64_stats_init(&per_cpu_ptr(pcpu, cpu)->syncp);
+
+	return pcpu;
+}
+
+/* Sum of all CPUs, cnt holds WCN36XX_STAT_NUM entries */
+void wcn36xx_stats_read(struct wcn36xx_pcpu_stats __percpu *pcpu, u64 *cnt)
+{
+	struct wcn36xx_pcpu_stats *s;
+	u64 tmp[WCN36XX_STAT_NUM];
+	unsigned int start;
+	int cpu, i;
+
+	memset(cnt, 0, sizeof(tmp));
+	if (!pcpu)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		s = per_cpu_ptr(pcpu, cpu);
+		do {
+			start = u64_stats_fetch_begin(&s->syncp);
+			memcpy(tmp, s->cnt, sizeof(tmp));
+		} while (u64_stats_fetch_retry(&s->syncp, start));
+
+		for (i = 0; i < WCN36XX_STAT_NUM; i++)
+			cnt[i] += tmp[i];
+	}
+}
+
+static struct wcn36xx_pcpu_stats *
+wcn36xx_stats_begin(struct wcn36xx_pcpu_stats __percpu *pcpu,
+		    unsigned long *flags)
+{
+	struct wcn36xx_pcpu_stats *s;
+
+	local_irq_save(*flags);
+	s = this_cpu_ptr(pcpu);
+	u64_stats_update_begin(&s->syncp);
+	return s;
+}
+
+static void wcn36xx_stats_end(struct wcn36xx_pcpu_stats *s,
+			      unsigned long flags)
+{
+	u64_stats_update_end(&s->syncp);
+	local_irq_restore(flags);
+}
+
+static void wcn36xx_stats_tx(struct wcn36xx_pcpu_stats __percpu *pcpu,
+			     unsigned int len, int ret)
+{
+	struct wcn36xx_pcpu_stats *s;
+	unsigned long flags;
+
+	if (!pcpu)
+		return;
+
+	s = wcn36xx_stats_begin(pcpu, &flags);
+	if (!ret) {
+		s->cnt[WCN36XX_STAT_TX_PACKETS]++;
+		s->cnt[WCN36XX_STAT_TX_BYTES] += len;
+	} else {
+		s->cnt[WCN36XX_STAT_TX_DROPPED]++;
+		if (ret == -EBUSY)
+			s->cnt[WCN36XX_STAT_TX_RING_FULL]++;
+	}
+	wcn36xx_stats_end(s, flags);
+}
+
+static void wcn36xx_stats_rx(struct wcn36xx_pcpu_stats __percpu *pcpu,
+			     unsigned int len)
+{
+	struct wcn36xx_pcpu_stats *s;
+	unsigned long flags;
+
+	if (!pcpu)
+		return;
+
+	s = wcn36xx_stats_begin(pcpu, &flags);
+	s->cnt[WCN36XX_STAT_RX_PACKETS]++;
+	s->cnt[WCN36XX_STAT_RX_BYTES] += len;
+	wcn36xx_stats_end(s, flags);
+}
+
+static void wcn36xx_stats_inc(struct wcn36xx_pcpu_stats __percpu *pcpu,
+			      enum wcn36xx_stat stat)
+{
+	struct wcn36xx_pcpu_stats *s;
+	unsigned long flags;
+
+	if (!pcpu)
+		return;
+
+	s = wcn36xx_stats_begin(pcpu, &flags);
+	s->cnt[stat]++;
+	wcn36xx_stats_end(s, flags);
+}
+
+/* Data frames are counted against the transmitting station and its vif */
+static void wcn36xx_rx_stats(struct wcn36xx *wcn, struct ieee80211_hdr *hdr,
+			     unsigned int len)
+{
+	struct wcn36xx_sta *sta_priv;
+	struct ieee80211_sta *sta;
+
+	rcu_read_lock();
+	sta = ieee80211_find_sta_by_ifaddr(wcn->hw, hdr->addr2,
+					   is_unicast_ether_addr(hdr->addr1) ?
+					   hdr->addr1 : NULL);
+	if (sta) {
+		sta_priv = wcn36xx_sta_to_priv(sta);
+		wcn36xx_stats_rx(sta_priv->stats, len);
+		if (sta_priv->vif)
+			wcn36xx_stats_rx(sta_priv->vif->stats, len);
+	}
+	rcu_read_unlock();
+}
+
+void wcn36xx_tx_status_stats(struct wcn36xx *wcn, struct sk_buff *skb,
+			     bool acked)
+{
+	struct ieee80211_hdr *hdr = (struct ieee80211_hdr *)skb->data;
+	struct ieee80211_tx_info *info = IEEE80211_SKB_CB(skb);
+	struct ieee80211_sta *sta;
+
+	if (acked)
+		return;
+
+	if (info->control.vif)
+		wcn36xx_stats_inc(wcn36xx_vif_to_priv(info->control.vif)->stats,
+				  WCN36XX_STAT_TX_STATUS_FAIL);
+
+	rcu_read_lock();
+	sta = ieee80211_find_sta_by_ifaddr(wcn->hw, hdr->addr1, hdr->addr2);
+	if (sta)
+		wcn36xx_stats_inc(wcn36xx_sta_to_priv(sta)->stats,
+				  WCN36XX_STAT_TX_STATUS_FAIL);
+	rcu_read_unlock();
+}
+
+/* ARP request for the offloaded IPv4 address */
+static bool wcn36xx_rx_arp_offloaded(struct wcn36xx_host_offload *offload,
+				     const u8 *arp, unsigned int len)
+{
+	const struct arphdr *ah = (const struct arphdr *)arp;
+	__be32 addr = ACCESS_ONCE(offload->arp_addr);
+	__be32 tpa;
+
+	/* Sender and target hardware and protocol addresses follow */
+	if (!addr || len < sizeof(*ah) + 2 * (ETH_ALEN + 4) ||
+	    ah->ar_op != htons(ARPOP_REQUEST) ||
+	    ah->ar_hln != ETH_ALEN || ah->ar_pln != 4)
+		return false;
+
+	memcpy(&tpa, arp + sizeof(*ah) + 2 * ETH_ALEN + 4, sizeof(tpa));
+	return tpa == addr;
+}
+
+/* Neighbor solicitation for one of the offloaded IPv6 addresses */
+static bool wcn36xx_rx_ns_offloaded(struct wcn36xx_host_offload *offload,
+				    const u8 *ip6, unsigned int len)
+{
+	const struct nd_msg *ns =
+		(const struct nd_msg *)(ip6 + sizeof(struct ipv6hdr));
+	int i, count;
+
+	if (len < sizeof(struct ipv6hdr) + sizeof(*ns) ||
+	    ((const struct ipv6hdr *)ip6)->nexthdr != IPPROTO_ICMPV6 ||
+	    ns->icmph.icmp6_type != NDISC_NEIGHBOUR_SOLICITATION)
+		return false;
+
+	count = min_t(int, ACCESS_ONCE(offload->ns_addr_cnt),
+		      WCN36XX_NS_OFFLOAD_ADDRS);
+	for (i = 0; i < count; i++)
+		if (ipv6_addr_equal(&ns->target, &offload->ns_addr[i]))
+			return true;
+
+	return false;
+}
+
+/*
+ * Count ARP and NS frames that firmware offload should have answered. The
+ * addresses are read without offload->lock in IRQ context, a racing
+ * update can only miscount a frame. vif_list is walked under RCU.
+ */
+static void wcn36xx_rx_offload_seen(struct wcn36xx *wcn, struct sk_buff *skb)
+{
+	struct ieee80211_hdr *hdr = (struct ieee80211_hdr *)skb->data;
+	unsigned int hdrlen = ieee80211_hdrlen(hdr->frame_control);
+	struct wcn36xx_host_offload *offload;
+	struct wcn36xx_vif *vif_priv;
+	struct ieee80211_vif *vif;
+	u8 *llc = skb->data + hdrlen;
+	u8 *payload = llc + sizeof(rfc1042_header) + 2;
+	unsigned int len;
+	__be16 proto;
+
+	if (skb->len < payload - skb->data ||
+	    memcmp(llc, rfc1042_header, sizeof(rfc1042_header)))
+		return;
+	proto = *(__be16 *)(llc + sizeof(rfc1042_header));
+	len = skb->len - (payload - skb->data);
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(vif_priv, &wcn->vif_list, list) {
+		vif = wcn36xx_priv_to_vif(vif_priv);
+		if (!vif_priv->sta_assoc ||
+		    !ether_addr_equal(vif->bss_conf.bssid, hdr->addr2))
+			continue;
+
+		offload = &vif_priv->offload;
+		if (proto == htons(ETH_P_ARP) &&
+		    wcn36xx_rx_arp_offloaded(offload, payload, len))
+			offload->arp_seen++;
+		else if (proto == htons(ETH_P_IPV6) &&
+			 wcn36xx_rx_ns_offloaded(offload, payload, len))
+			offload->ns_seen++;
+		break;
+	}
+	rcu_read_unlock();
+}
+
 int wcn36xx_rx_skb(struct wcn36xx *wcn, struct sk_buff *skb)
 {
 	struct ieee80211_rx_status status;
@@ -46,25 +398,55 @@ int wcn36xx_rx_skb(struct wcn36xx *wcn, struct sk_buff *skb)
 	skb_put(skb, bd->pdu.mpdu_header_off + bd->pdu.mpdu_len);
 	skb_pull(skb, bd->pdu.mpdu_header_off);
 
-	status.mactime = 10;
-	status.freq = WCN36XX_CENTER_FREQ(wcn);
-	status.band = WCN36XX_BAND(wcn);
-	status.signal = -get_rssi0(bd);
+	if (wcn->scan_freq) {
+		/* Radio is off the operating channel for a scan */
+		status.freq = wcn->scan_freq;
+		status.band = wcn->scan_band;
+	} else {
+		status.freq = WCN36XX_CENTER_FREQ(wcn);
+		status.band = WCN36XX_BAND(wcn);
+	}
+	wcn36xx_rx_signal(bd, &status);
 	status.antenna = 1;
-	status.rate_idx = 1;
 	status.flag = 0;
 	status.rx_flags = 0;
 	status.flag |= RX_FLAG_IV_STRIPPED |
 		       RX_FLAG_MMIC_STRIPPED |
 		       RX_FLAG_DECRYPTED;
+	wcn36xx_rx_rate(bd, &status);
 
-	wcn36xx_dbg(WCN36XX_DBG_RX, "status.flags=%x status->vendor_radiotap_len=%x\n",
-		    status.flag,  status.vendor_radiotap_len);
+	hdr = (struct ieee80211_hdr *) skb->data;
+	fc = __le16_to_cpu(hdr->frame_control);
+
+	/*
+	 * rx_times is the low word of the TSF latched at the start of the
+	 * PPDU. It is only handed to mac80211 as mactime for data frames:
+	 * with TIMING_BEACON_ONLY a beacon mactime would be taken as the
+	 * full 64 bit TSF for DTIM sync and IBSS merge decisions.
+	 */
+	status.device_timestamp = bd->rx_times;
+	if (ieee80211_is_data(hdr->frame_control)) {
+		status.mactime = bd->rx_times;
+		status.flag |= RX_FLAG_MACTIME_START;
+	}
+
+	wcn36xx_dbg(WCN36XX_DBG_RX,
+		    "status.flags=%x rate_id %d idx %d signal %d tsf %u\n",
+		    status.flag, bd->rate_id, status.rate_idx, status.signal,
+		    bd->rx_times);
 
 	memcpy(IEEE80211_SKB_RXCB(skb), &status, sizeof(status));
 
-	hdr = (struct ieee80211_hdr *) skb->data;
-	fc = __le16_to_cpu(hdr->frame_control);
+	if (ieee80211_is_data(hdr->frame_control))
+		wcn36xx_rx_stats(wcn, hdr, skb->len);
+	if (wcn->scan_bg && ieee80211_is_data(hdr->frame_control))
+		atomic_inc(&wcn->scan_traffic);
+	if (ieee80211_is_data(hdr->frame_control) &&
+	    is_unicast_ether_addr(hdr->addr1))
+		wcn36xx_pmc_rx_activity(wcn, hdr);
+	if (ieee80211_is_data(hdr->frame_control) &&
+	    is_multicast_ether_addr(hdr->addr1))
+		wcn36xx_rx_offload_seen(wcn, skb);
 	sn = IEEE80211_SEQ_TO_SN(__le16_to_cpu(hdr->seq_ctrl));
 
 	if (ieee80211_is_beacon(hdr->frame_control)) {
@@ -113,14 +495,21 @@ static inline struct wcn36xx_vif *get_vif_by_addr(struct wcn36xx *wcn,
 }
 
 /*
- * Initiate TX a-mpdu with the station if we can.
+ * Initiate TX a-mpdu with the station once a TID sustains enough load.
+ *
+ * Load is measured per TID over WCN36XX_AMPDU_WINDOW. Idle sessions are
+ * torn down by mac80211 through the session timeout, which frees the
+ * firmware BA slot for a busier TID.
  */
 static void wcn36xx_tx_start_ampdu(struct wcn36xx *wcn,
 				   struct wcn36xx_sta *sta_priv,
 				   struct sk_buff *skb)
 {
 	struct ieee80211_hdr *hdr = (struct ieee80211_hdr *)skb->data;
+	struct wcn36xx_tid_ampdu *ampdu;
 	struct ieee80211_sta *sta;
+	unsigned int elapsed, pps, kbps;
+	unsigned long start, now;
 	u8 *qc, tid;
 
 	if (!conf_is_ht(&wcn->hw->conf))
@@ -131,23 +520,54 @@ static void wcn36xx_tx_start_ampdu(struct wcn36xx *wcn,
 	if (WARN_ON(!ieee80211_is_data_qos(hdr->frame_control)))
 		return;
 
-	if (skb_get_queue_mapping(skb) == IEEE80211_AC_VO)
+	if (skb_get_queue_mapping(skb) == IEEE80211_AC_VO && !ampdu_vo)
 		return;
 
 	qc = ieee80211_get_qos_ctl(hdr);
 	tid = qc[0] & IEEE80211_QOS_CTL_TID_MASK;
+	ampdu = &sta_priv->ampdu[tid];
 
-	spin_lock(&sta_priv->ampdu_lock);
-	if (sta_priv->ampdu_state[tid] != WCN36XX_AMPDU_NONE)
-		goto out_unlock;
+	if (atomic_read(&ampdu->state) != WCN36XX_AMPDU_NONE)
+		return;
+
+	now = jiffies;
+	if (atomic_inc_return(&ampdu->pkts) == 1)
+		ACCESS_ONCE(ampdu->start) = now;
+	atomic_add(skb->len, &ampdu->bytes);
+
+	start = ACCESS_ONCE(ampdu->start);
+	elapsed = jiffies_to_msecs(now - start);
+	if (elapsed < WCN36XX_AMPDU_WINDOW)
+		return;
+
+	/* Only the CPU that closes the window evaluates it */
+	if (cmpxchg(&ampdu->start, start, now) != start)
+		return;
+
+	pps = atomic_xchg(&ampdu->pkts, 0) * 1000 / elapsed;
+	kbps = atomic_xchg(&ampdu->bytes, 0) * 8 / elapsed;
 
-	if (sta_priv->non_agg_frame_ct++ >= WCN36XX_AMPDU_START_THRESH) {
-		sta_priv->ampdu_state[tid] = WCN36XX_AMPDU_START;
-		sta_priv->non_agg_frame_ct = 0;
-		ieee80211_start_tx_ba_session(sta, tid, 0);
+	if (pps < ampdu_min_pps || kbps < ampdu_min_kbps)
+		return;
+
+	if (atomic_inc_return(&wcn->ba_sessions) > ampdu_max_sessions) {
+		atomic_dec(&wcn->ba_sessions);
+		return;
 	}
-out_unlock:
-	spin_unlock(&sta_priv->ampdu_lock);
+
+	if (atomic_cmpxchg(&ampdu->state, WCN36XX_AMPDU_NONE,
+			   WCN36XX_AMPDU_START) != WCN36XX_AMPDU_NONE) {
+		atomic_dec(&wcn->ba_sessions);
+		return;
+	}
+
+	wcn36xx_dbg(WCN36XX_DBG_TX, "tx start ampdu %pM tid %d pps %u kbps %u\n",
+		    sta->addr, tid, pps, kbps);
+
+	if (ieee80211_start_tx_ba_session(sta, tid, ampdu_idle_tu) &&
+	    atomic_cmpxchg(&ampdu->state, WCN36XX_AMPDU_START,
+			   WCN36XX_AMPDU_NONE) == WCN36XX_AMPDU_START)
+		atomic_dec(&wcn->ba_sessions);
 }
 
 static void wcn36xx_set_tx_data(struct wcn36xx_tx_bd *bd,
@@ -205,7 +625,9 @@ static void wcn36xx_set_tx_data(struct wcn36xx_tx_bd *bd,
 			   is_data_qos ?
 			   sizeof(struct ieee80211_qos_hdr) :
 			   sizeof(struct ieee80211_hdr_3addr),
-			   skb->len, sta_priv ? sta_priv->tid : 0);
+			   skb->len, is_data_qos ?
+			   *ieee80211_get_qos_ctl(hdr) &
+			   IEEE80211_QOS_CTL_TID_MASK : 0);
 
 	if (sta_priv && is_data_qos)
 		wcn36xx_tx_start_ampdu(wcn, sta_priv, skb);
@@ -220,13 +642,16 @@ static void wcn36xx_set_tx_mgmt(struct wcn36xx_tx_bd *bd,
 	struct ieee80211_hdr *hdr = (struct ieee80211_hdr *)skb->data;
 	struct wcn36xx_vif *__vif_priv =
 		get_vif_by_addr(wcn, hdr->addr2);
+	enum ieee80211_band band = wcn->scan_freq ?
+		wcn->scan_band : WCN36XX_BAND(wcn);
+
 	bd->sta_index = __vif_priv->self_sta_index;
 	bd->dpu_desc_idx = __vif_priv->self_dpu_desc_index;
 	bd->dpu_ne = 1;
 
 	/* default rate for unicast */
 	if (ieee80211_is_mgmt(hdr->frame_control))
-		bd->bd_rate = (WCN36XX_BAND(wcn) == IEEE80211_BAND_5GHZ) ?
+		bd->bd_rate = (band == IEEE80211_BAND_5GHZ) ?
 			WCN36XX_BD_RATE_CTRL :
 			WCN36XX_BD_RATE_MGMT;
 	else if (ieee80211_is_ctl(hdr->frame_control))
@@ -259,9 +684,9 @@ static void wcn36xx_set_tx_mgmt(struct wcn36xx_tx_bd *bd,
 			   skb->len, WCN36XX_TID);
 }
 
-int wcn36xx_start_tx(struct wcn36xx *wcn,
-		     struct wcn36xx_sta *sta_priv,
-		     struct sk_buff *skb)
+static int __wcn36xx_start_tx(struct wcn36xx *wcn,
+			      struct wcn36xx_sta *sta_priv,
+			      struct sk_buff *skb)
 {
 	struct ieee80211_hdr *hdr = (struct ieee80211_hdr *)skb->data;
 	struct wcn36xx_vif *vif_priv = NULL;
@@ -317,6 +742,9 @@ int wcn36xx_start_tx(struct wcn36xx *wcn,
 		ieee80211_stop_queues(wcn->hw);
 	}
 
+	if (is_low && wcn->scan_bg)
+		atomic_inc(&wcn->scan_traffic);
+
 	/* Data frames served first*/
 	if (is_low)
 		wcn36xx_set_tx_data(bd, wcn, &vif_priv, sta_priv, skb, bcast);
@@ -324,8 +752,325 @@ int wcn36xx_start_tx(struct wcn36xx *wcn,
 		/* MGMT and CTRL frames are handeld here*/
 		wcn36xx_set_tx_mgmt(bd, wcn, &vif_priv, skb, bcast);
 
+	/* Feed the BMPS governor, U-APSD ACs are served in power save */
+	if (is_low && vif_priv &&
+	    !(vif_priv->uapsd_active &&
+	      vif_priv->uapsd_acs & BIT(skb_get_queue_mapping(skb))))
+		atomic_inc(&vif_priv->pmc.activity);
+
 	buff_to_be((u32 *)bd, sizeof(*bd)/sizeof(u32));
 	bd->tx_bd_sign = 0xbdbdbdbd;
 
 	return wcn36xx_dxe_tx_frame(wcn, vif_priv, skb, is_low);
 }
+
+int wcn36xx_start_tx(struct wcn36xx *wcn,
+		     struct wcn36xx_sta *sta_priv,
+		     struct sk_buff *skb)
+{
+	struct ieee80211_tx_info *info = IEEE80211_SKB_CB(skb);
+	struct wcn36xx_vif *vif_priv = NULL;
+	unsigned int len = skb->len;
+	int ret;
+
+	if (info->control.vif)
+		vif_priv = wcn36xx_vif_to_priv(info->control.vif);
+
+	/* Once on the ring the frame may be completed and freed any time */
+	ret = __wcn36xx_start_tx(wcn, sta_priv, skb);
+
+	if (sta_priv)
+		wcn36xx_stats_tx(sta_priv->stats, len, ret);
+	if (vif_priv)
+		wcn36xx_stats_tx(vif_priv->stats, len, ret);
+
+	return ret;
+}
+
+/*
+ * Small QoS data frames on TIDs without an a-mpdu session are held for up
+ * to amsdu_latency_us and sent as one A-MSDU, so that a burst of TCP ACKs
+ * costs one BD and DXE pair instead of one per frame. A-MSDU inside
+ * a-mpdu is not negotiated by mac80211 so aggregated TIDs are left alone.
+ */
+static bool wcn36xx_amsdu_eligible(struct wcn36xx_sta *sta_priv,
+				   struct sk_buff *skb, u8 *tid)
+{
+	struct ieee80211_hdr *hdr = (struct ieee80211_hdr *)skb->data;
+	struct ieee80211_tx_info *info = IEEE80211_SKB_CB(skb);
+	struct ieee80211_sta *sta = wcn36xx_priv_to_sta(sta_priv);
+	u8 *qc;
+
+	if (!ieee80211_is_data_qos(hdr->frame_control))
+		return false;
+
+	qc = ieee80211_get_qos_ctl(hdr);
+	*tid = qc[0] & IEEE80211_QOS_CTL_TID_MASK;
+
+	if (!amsdu_latency_us || !sta->ht_cap.ht_supported)
+		return false;
+
+	if (is_multicast_ether_addr(hdr->addr1) ||
+	    (info->flags & IEEE80211_TX_CTL_REQ_TX_STATUS) ||
+	    (qc[0] & IEEE80211_QOS_CTL_A_MSDU_PRESENT) ||
+	    skb->protocol == cpu_to_be16(ETH_P_PAE) ||
+	    skb_is_nonlinear(skb))
+		return false;
+
+	if (ieee80211_hdrlen(hdr->frame_control) !=
+	    sizeof(struct ieee80211_qos_hdr))
+		return false;
+
+	if (skb->len - sizeof(struct ieee80211_qos_hdr) >
+	    WCN36XX_AMSDU_MSDU_MAX)
+		return false;
+
+	return atomic_read(&sta_priv->ampdu[*tid].state) == WCN36XX_AMPDU_NONE;
+}
+
+static unsigned int wcn36xx_amsdu_subframe_len(struct sk_buff *skb)
+{
+	return ALIGN(ETH_HLEN + skb->len - sizeof(struct ieee80211_qos_hdr), 4);
+}
+
+static unsigned int wcn36xx_amsdu_len(struct sk_buff_head *q)
+{
+	struct sk_buff *skb;
+	unsigned int len = 0;
+
+	skb_queue_walk(q, skb)
+		len += wcn36xx_amsdu_subframe_len(skb);
+
+	return len;
+}
+
+static struct sk_buff *wcn36xx_amsdu_build(struct wcn36xx_sta *sta_priv,
+					   struct sk_buff_head *q)
+{
+	struct ieee80211_vif *vif = wcn36xx_priv_to_vif(sta_priv->vif);
+	int hdrlen = sizeof(struct ieee80211_qos_hdr);
+	struct sk_buff *first = skb_peek(q), *skb, *amsdu;
+	struct ieee80211_hdr *hdr;
+	struct ethhdr *eth;
+	unsigned int msdu_len, pad;
+
+	amsdu = dev_alloc_skb(hdrlen + wcn36xx_amsdu_len(q));
+	if (!amsdu)
+		return NULL;
+
+	memcpy(amsdu->cb, first->cb, sizeof(amsdu->cb));
+	skb_set_queue_mapping(amsdu, skb_get_queue_mapping(first));
+	amsdu->priority = first->priority;
+	amsdu->protocol = first->protocol;
+
+	memcpy(skb_put(amsdu, hdrlen), first->data, hdrlen);
+	hdr = (struct ieee80211_hdr *)amsdu->data;
+	*ieee80211_get_qos_ctl(hdr) |= IEEE80211_QOS_CTL_A_MSDU_PRESENT;
+	/* DA and SA move to the subframes, the outer header carries BSSID */
+	memcpy(hdr->addr3, vif->bss_conf.bssid, ETH_ALEN);
+
+	skb_queue_walk(q, skb) {
+		/* Every subframe but the last is padded to 4 bytes */
+		pad = (4 - ((amsdu->len - hdrlen) & 3)) & 3;
+		memset(skb_put(amsdu, pad), 0, pad);
+
+		hdr = (struct ieee80211_hdr *)skb->data;
+		msdu_len = skb->len - hdrlen;
+		eth = (struct ethhdr *)skb_put(amsdu, ETH_HLEN);
+		memcpy(eth->h_dest, ieee80211_get_DA(hdr), ETH_ALEN);
+		memcpy(eth->h_source, ieee80211_get_SA(hdr), ETH_ALEN);
+		eth->h_proto = cpu_to_be16(msdu_len);
+		memcpy(skb_put(amsdu, msdu_len), skb->data + hdrlen, msdu_len);
+	}
+
+	return amsdu;
+}
+
+static void wcn36xx_amsdu_arm(struct wcn36xx *wcn)
+{
+	if (!hrtimer_active(&wcn->amsdu_timer))
+		hrtimer_start(&wcn->amsdu_timer,
+			      ns_to_ktime(amsdu_latency_us * NSEC_PER_USEC),
+			      HRTIMER_MODE_REL);
+}
+
+/*
+ * Called with amsdu_lock held, leaves @q empty. While the DXE ring is full
+ * the frames stay held and -EBUSY is returned, the caller re-arms the
+ * timer to try again.
+ */
+static int wcn36xx_amsdu_send(struct wcn36xx *wcn,
+			      struct wcn36xx_sta *sta_priv,
+			      struct sk_buff_head *q)
+{
+	struct sk_buff *skb, *amsdu = NULL;
+	int ret;
+
+	if (wcn->queues_stopped)
+		return -EBUSY;
+
+	if (skb_queue_len(q) > 1)
+		amsdu = wcn36xx_amsdu_build(sta_priv, q);
+
+	if (amsdu) {
+		wcn36xx_dbg(WCN36XX_DBG_TX, "tx amsdu %d subframes len %d\n",
+			    skb_queue_len(q), amsdu->len);
+
+		ret = wcn36xx_start_tx(wcn, sta_priv, amsdu);
+		if (ret)
+			ieee80211_free_txskb(wcn->hw, amsdu);
+		if (ret == -EBUSY)
+			return ret;
+
+		while ((skb = __skb_dequeue(q)))
+			ieee80211_free_txskb(wcn->hw, skb);
+		return 0;
+	}
+
+	while ((skb = __skb_dequeue(q))) {
+		ret = wcn36xx_start_tx(wcn, sta_priv, skb);
+		if (ret == -EBUSY) {
+			__skb_queue_head(q, skb);
+			return ret;
+		}
+		if (ret)
+			ieee80211_free_txskb(wcn->hw, skb);
+	}
+	return 0;
+}
+
+/* Keeps the station on amsdu_list when frames are left held */
+static int __wcn36xx_tx_amsdu_flush(struct wcn36xx *wcn,
+				    struct wcn36xx_sta *sta_priv)
+{
+	int tid, ret;
+
+	for (tid = 0; tid < IEEE80211_NUM_TIDS; tid++) {
+		if (skb_queue_empty(&sta_priv->amsdu_q[tid]))
+			continue;
+		ret = wcn36xx_amsdu_send(wcn, sta_priv,
+					 &sta_priv->amsdu_q[tid]);
+		if (ret)
+			return ret;
+	}
+
+	list_del_init(&sta_priv->amsdu_node);
+	return 0;
+}
+
+/*
+ * Returns true when the frame was taken over, either held for an A-MSDU
+ * or sent behind the frames held before it.
+ */
+bool wcn36xx_tx_amsdu(struct wcn36xx *wcn,
+		      struct wcn36xx_sta *sta_priv,
+		      struct sk_buff *skb)
+{
+	struct sk_buff_head *q;
+	u8 tid = IEEE80211_NUM_TIDS;
+	bool eligible;
+
+	eligible = wcn36xx_amsdu_eligible(sta_priv, skb, &tid);
+	if (tid >= IEEE80211_NUM_TIDS)
+		return false;
+
+	q = &sta_priv->amsdu_q[tid];
+	if (!eligible && skb_queue_empty(q))
+		return false;
+
+	spin_lock_bh(&wcn->amsdu_lock);
+
+	if (!eligible) {
+		/* Keep the TID in order behind what is held */
+		if (wcn36xx_amsdu_send(wcn, sta_priv, q)) {
+			/* The ring is full, the frame would fail on it as well */
+			ieee80211_free_txskb(wcn->hw, skb);
+			goto out_hold;
+		}
+		if (wcn36xx_start_tx(wcn, sta_priv, skb))
+			ieee80211_free_txskb(wcn->hw, skb);
+		goto out_unlock;
+	}
+
+	if (wcn36xx_amsdu_len(q) + wcn36xx_amsdu_subframe_len(skb) >
+	    WCN36XX_AMSDU_MAX && wcn36xx_amsdu_send(wcn, sta_priv, q)) {
+		ieee80211_free_txskb(wcn->hw, skb);
+		goto out_hold;
+	}
+
+	__skb_queue_tail(q, skb);
+
+	if (skb_queue_len(q) >= WCN36XX_AMSDU_SUBFRAMES &&
+	    !wcn36xx_amsdu_send(wcn, sta_priv, q))
+		goto out_unlock;
+
+out_hold:
+	if (list_empty(&sta_priv->amsdu_node))
+		list_add_tail(&sta_priv->amsdu_node, &wcn->amsdu_list);
+	wcn36xx_amsdu_arm(wcn);
+
+out_unlock:
+	spin_unlock_bh(&wcn->amsdu_lock);
+	return true;
+}
+
+void wcn36xx_tx_amsdu_flush(struct wcn36xx *wcn, struct wcn36xx_sta *sta_priv)
+{
+	spin_lock_bh(&wcn->amsdu_lock);
+	if (__wcn36xx_tx_amsdu_flush(wcn, sta_priv))
+		wcn36xx_amsdu_arm(wcn);
+	spin_unlock_bh(&wcn->amsdu_lock);
+}
+
+void wcn36xx_tx_amsdu_purge(struct wcn36xx *wcn, struct wcn36xx_sta *sta_priv)
+{
+	struct sk_buff *skb;
+	int tid;
+
+	spin_lock_bh(&wcn->amsdu_lock);
+	for (tid = 0; tid < IEEE80211_NUM_TIDS; tid++)
+		while ((skb = __skb_dequeue(&sta_priv->amsdu_q[tid])))
+			ieee80211_free_txskb(wcn->hw, skb);
+	list_del_init(&sta_priv->amsdu_node);
+	spin_unlock_bh(&wcn->amsdu_lock);
+}
+
+static void wcn36xx_tx_amsdu_tasklet(unsigned long data)
+{
+	struct wcn36xx *wcn = (struct wcn36xx *)data;
+	struct wcn36xx_sta *sta_priv, *tmp;
+
+	spin_lock_bh(&wcn->amsdu_lock);
+	list_for_each_entry_safe(sta_priv, tmp, &wcn->amsdu_list, amsdu_node) {
+		/* Ring full, keep holding until it drains */
+		if (__wcn36xx_tx_amsdu_flush(wcn, sta_priv)) {
+			wcn36xx_amsdu_arm(wcn);
+			break;
+		}
+	}
+	spin_unlock_bh(&wcn->amsdu_lock);
+}
+
+static enum hrtimer_restart wcn36xx_tx_amsdu_timer(struct hrtimer *timer)
+{
+	struct wcn36xx *wcn = container_of(timer, struct wcn36xx, amsdu_timer);
+
+	tasklet_schedule(&wcn->amsdu_tasklet);
+	return HRTIMER_NORESTART;
+}
+
+void wcn36xx_tx_amsdu_init(struct wcn36xx *wcn)
+{
+	spin_lock_init(&wcn->amsdu_lock);
+	INIT_LIST_HEAD(&wcn->amsdu_list);
+	hrtimer_init(&wcn->amsdu_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	wcn->amsdu_timer.function = wcn36xx_tx_amsdu_timer;
+	tasklet_init(&wcn->amsdu_tasklet, wcn36xx_tx_amsdu_tasklet,
+		     (unsigned long)wcn);
+}
+
+void wcn36xx_tx_amsdu_stop(struct wcn36xx *wcn)
+{
+	hrtimer_cancel(&wcn->amsdu_timer);
+	tasklet_kill(&wcn->amsdu_tasklet);
+}
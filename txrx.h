@@ -19,6 +19,7 @@
 #define _TXRX_H_
 
 #include <linux/etherdevice.h>
+#include <linux/u64_stats_sync.h>
 #include "wcn36xx.h"
 
 /* TODO describe all properties */
@@ -157,12 +158,48 @@ struct wcn36xx_tx_bd {
 	u32	reserved7:6;*/
 };
 
+/* Data path counters kept per station and per vif */
+enum wcn36xx_stat {
+	WCN36XX_STAT_TX_PACKETS,
+	WCN36XX_STAT_TX_BYTES,
+	/* Frames handed back to mac80211 unsent, ring full included */
+	WCN36XX_STAT_TX_DROPPED,
+	WCN36XX_STAT_TX_RING_FULL,
+	/* Frames that asked for TX status and were not acknowledged */
+	WCN36XX_STAT_TX_STATUS_FAIL,
+	WCN36XX_STAT_RX_PACKETS,
+	WCN36XX_STAT_RX_BYTES,
+	WCN36XX_STAT_NUM
+};
+
+/*
+ * One copy per CPU so the TX and RX paths never share a cache line.
+ * Updates run with interrupts off as RX comes from the DXE interrupt.
+ */
+struct wcn36xx_pcpu_stats {
+	u64 cnt[WCN36XX_STAT_NUM];
+	struct u64_stats_sync syncp;
+};
+
 struct wcn36xx_sta;
 struct wcn36xx;
 
+struct wcn36xx_pcpu_stats __percpu *wcn36xx_stats_alloc(void);
+void wcn36xx_stats_read(struct wcn36xx_pcpu_stats __percpu *pcpu,
+			u64 *cnt);
+void wcn36xx_tx_status_stats(struct wcn36xx *wcn, struct sk_buff *skb,
+			     bool acked);
+
 int  wcn36xx_rx_skb(struct wcn36xx *wcn, struct sk_buff *skb);
 int wcn36xx_start_tx(struct wcn36xx *wcn,
 		     struct wcn36xx_sta *sta_priv,
 		     struct sk_buff *skb);
+bool wcn36xx_tx_amsdu(struct wcn36xx *wcn,
+		      struct wcn36xx_sta *sta_priv,
+		      struct sk_buff *skb);
+void wcn36xx_tx_amsdu_flush(struct wcn36xx *wcn, struct wcn36xx_sta *sta_priv);
+void wcn36xx_tx_amsdu_purge(struct wcn36xx *wcn, struct wcn36xx_sta *sta_priv);
+void wcn36xx_tx_amsdu_init(struct wcn36xx *wcn);
+void wcn36xx_tx_amsdu_stop(struct wcn36xx *wcn);
 
 #endif	/* _TXRX_H_ */
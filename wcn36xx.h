@@ -19,8 +19,11 @@
 #define _WCN36XX_H_
 
 #include <linux/completion.h>
+#include <linux/hrtimer.h>
+#include <linux/interrupt.h>
 #include <linux/printk.h>
 #include <linux/spinlock.h>
+#include <linux/in6.h>
 #include <net/mac80211.h>
 
 #include "hal.h"
@@ -33,8 +36,21 @@
 #define WLAN_NV_FILE               "wlan/prima/WCNSS_qcom_wlan_nv.bin"
 #define WCN36XX_AGGR_BUFFER_SIZE 64
 
-/* How many frames until we start a-mpdu TX session */
-#define WCN36XX_AMPDU_START_THRESH	20
+/* BA sessions firmware is configured for, RX and TX together */
+#define WCN36XX_MAX_BA_SESSIONS	40
+/* Reorder buffers firmware shares among all BA sessions */
+#define WCN36XX_MAX_BA_BUFFERS	2560
+/* Smallest window worth opening a TX BA session for */
+#define WCN36XX_BA_MIN_WIN	8
+
+/* TX A-MSDU: largest MSDU packed into one and subframes per A-MSDU */
+#define WCN36XX_AMSDU_MSDU_MAX	512
+#define WCN36XX_AMSDU_SUBFRAMES	8
+/* Largest A-MSDU, the 7935 byte one does not fit a DXE packet buffer */
+#define WCN36XX_AMSDU_MAX	3839
+
+/* Period in ms over which per TID TX load is measured for a-mpdu */
+#define WCN36XX_AMPDU_WINDOW	100
 
 extern unsigned int wcn36xx_dbg_mask;
 
@@ -85,6 +101,11 @@ enum wcn36xx_ampdu_state {
 	WCN36XX_AMPDU_OPERATIONAL,
 };
 
+/* Probe request IEs must fit in hal_buf next to the scan offload request */
+#define WCN36XX_MAX_SCAN_IE_LEN		500
+/* Leaves room for the probe request header in the PNO probe template */
+#define WCN36XX_MAX_SCHED_SCAN_IE_LEN	400
+
 #define WCN36XX_HW_CHANNEL(__wcn) (__wcn->hw->conf.chandef.chan->hw_value)
 #define WCN36XX_BAND(__wcn) (__wcn->hw->conf.chandef.chan->band)
 #define WCN36XX_CENTER_FREQ(__wcn) (__wcn->hw->conf.chandef.chan->center_freq)
@@ -104,6 +125,40 @@ struct nv_data {
 	u8	table;
 };
 
+/* Number of HAL message types tracked by the SMD dispatch table */
+#define WCN36XX_HAL_MSG_NUM	(WCN36XX_HAL_SCAN_OFFLOAD_IND + 1)
+
+/*
+ * HAL latency histogram: bucket 0 counts responses faster than
+ * WCN36XX_HAL_LAT_BASE_US, every following bucket doubles the upper bound
+ * and the last bucket counts everything slower than that.
+ */
+#define WCN36XX_HAL_LAT_BUCKETS		16
+#define WCN36XX_HAL_LAT_BASE_US		32
+
+/**
+ * struct wcn36xx_hal_msg_stats - per HAL message type statistics
+ *
+ * @count: number of messages of this type sent or received.
+ * @bytes: total length of those messages.
+ * @completed: requests that got a response, used for the average latency.
+ * @timeouts: requests that got no response in time.
+ * @lat_min: smallest request to response latency in usecs.
+ * @lat_max: largest request to response latency in usecs.
+ * @lat_total: sum of all latencies in usecs.
+ * @lat_hist: latency histogram, see WCN36XX_HAL_LAT_BUCKETS.
+ */
+struct wcn36xx_hal_msg_stats {
+	u32	count;
+	u64	bytes;
+	u32	completed;
+	u32	timeouts;
+	u32	lat_min;
+	u32	lat_max;
+	u64	lat_total;
+	u32	lat_hist[WCN36XX_HAL_LAT_BUCKETS];
+};
+
 /* Interface for platform control path
  *
  * @open: hook must be called when wcn36xx wants to open control channel.
@@ -117,6 +172,93 @@ struct wcn36xx_platform_ctrl_ops {
 	int (*smsm_change_state)(u32 clear_mask, u32 set_mask);
 };
 
+/* The HAL NS offload answers for at most two target addresses */
+#define WCN36XX_NS_OFFLOAD_ADDRS	2
+
+/**
+ * struct wcn36xx_host_offload - ARP and NS offload of a vif
+ *
+ * @lock: protects the addresses, IPv6 changes arrive in atomic context.
+ * @arp_addr: offloaded IPv4 address, 0 when ARP offload is off.
+ * @ns_addr: offloaded IPv6 addresses.
+ * @ns_addr_cnt: number of valid entries in @ns_addr.
+ * @arp_updates: ARP offload configurations accepted by firmware.
+ * @ns_updates: NS offload configurations accepted by firmware.
+ * @arp_seen: ARP frames that still reached the host while offloaded.
+ * @ns_seen: neighbor solicitations that still reached the host while
+ *	offloaded.
+ */
+struct wcn36xx_host_offload {
+	spinlock_t lock;
+	__be32 arp_addr;
+	struct in6_addr ns_addr[WCN36XX_NS_OFFLOAD_ADDRS];
+	int ns_addr_cnt;
+
+	u32 arp_updates;
+	u32 ns_updates;
+	u32 arp_seen;
+	u32 ns_seen;
+};
+
+/**
+ * struct wcn36xx_mc_list - multicast addresses to program in firmware
+ *
+ * @overflow: the stack asked for more than the firmware holds, so the
+ *	list is not used and all multicast is accepted.
+ * @count: number of entries in @addr.
+ * @addr: the addresses, sized to @count.
+ */
+struct wcn36xx_mc_list {
+	bool overflow;
+	u32 count;
+	u8 addr[][ETH_ALEN];
+};
+
+/**
+ * struct wcn36xx_pkt_filter - firmware RX packet filter
+ *
+ * @used: the slot holds a filter.
+ * @type: enum wcn36xx_hal_receive_packet_filter_type, FILTER_PKT drops
+ *	matching frames in firmware, BUFFER_PKT holds them for the host.
+ * @params_count: number of valid @params, all of them have to match.
+ * @params: comparisons in the HAL layout.
+ * @match_cnt: frames matched, as last read back from firmware.
+ */
+struct wcn36xx_pkt_filter {
+	bool used;
+	u8 type;
+	u8 params_count;
+	struct wcn36xx_hal_rcv_pkt_filter_params
+		params[WCN36XX_HAL_MAX_CMP_PER_FILTER];
+	u32 match_cnt;
+};
+
+/* Categories requested with GET_STATS */
+#define WCN36XX_FW_STATS_MASK	(HAL_SUMMARY_STATS_INFO | \
+				 HAL_GLOBAL_CLASS_A_STATS_INFO | \
+				 HAL_PER_STA_STATS_INFO)
+
+/**
+ * struct wcn36xx_fw_stats - firmware counters read back with GET_STATS
+ *
+ * @mask: categories carried by the last response
+ * @summary: per AC TX frames, retries and failures, RX frames and errors
+ * @class_a: RX fragments, sync failures and the last TX rate
+ * @per_sta: per AC acknowledged MPDUs and TX a-mpdu counters of the peer
+ * @updated: jiffies of the last successful read, 0 before the first
+ * @polls: GET_STATS requests sent
+ * @failures: GET_STATS requests that failed
+ */
+struct wcn36xx_fw_stats {
+	u32 mask;
+	struct ani_summary_stats_info summary;
+	struct ani_global_class_a_stats_info class_a;
+	struct ani_per_sta_stats_info per_sta;
+	unsigned long updated;
+	u32 polls;
+	u32 failures;
+};
+
 /**
  * struct wcn36xx_vif - holds VIF related fields
  *
@@ -134,6 +276,33 @@ struct wcn36xx_vif {
 
 	/* Power management */
 	enum wcn36xx_power_state pw_state;
+	struct wcn36xx_pmc pmc;
+	/* U-APSD enabled ACs, bitmap of IEEE80211_AC_* from conf_tx */
+	u8 uapsd_acs;
+	bool uapsd_active;
+
+	/* EDCA parameters from conf_tx indexed by IEEE80211_AC_* */
+	struct wcn36xx_hal_edca_param_record edca[IEEE80211_NUM_ACS];
+	bool edca_valid;
+
+	/* Firmware counters of the vif's peer, under wcn->stats_lock */
+	struct wcn36xx_fw_stats fw_stats;
+	/* Data path counters of all the vif's frames */
+	struct wcn36xx_pcpu_stats __percpu *stats;
+
+	/* Multicast list last accepted by firmware, NULL is all multicast */
+	struct wcn36xx_mc_list *mc_list;
+	bool mc_valid;
+
+	struct wcn36xx_host_offload offload;
+
+	/* GTK rekey material from set_rekey_data, offloaded on suspend */
+	struct {
+		u8 kck[NL80211_KCK_LEN];
+		u8 kek[NL80211_KEK_LEN];
+		u64 replay_ctr;
+		bool valid;
+	} rekey_data;
 
 	u8 bss_index;
 	/* Returned from WCN36XX_HAL_ADD_STA_SELF_RSP */
@@ -142,10 +311,26 @@ struct wcn36xx_vif {
 	u8 self_ucast_dpu_sign;
 };
 
+/**
+ * struct wcn36xx_tid_ampdu - TX a-mpdu state of one TID
+ *
+ * Read and updated on the TX path without locks.
+ *
+ * @state: enum wcn36xx_ampdu_state, transitions are made with cmpxchg/xchg
+ * @start: jiffies at which the current load measurement window opened
+ * @pkts: QoS data frames queued in the window
+ * @bytes: bytes queued in the window
+ */
+struct wcn36xx_tid_ampdu {
+	atomic_t state;
+	unsigned long start;
+	atomic_t pkts;
+	atomic_t bytes;
+};
+
 /**
  * struct wcn36xx_sta - holds STA related fields
  *
- * @tid: traffic ID that is used during AMPDU and in TX BD.
  * @sta_index: STA index is returned from HW after config_sta call and is
  * used in both SMD channel and TX BD.
  * @dpu_desc_index: DPU descriptor index is returned from HW after config_sta
@@ -163,11 +348,21 @@ struct wcn36xx_vif {
  * |______________|_____________|_______________|
  * |smd_delete_sta|  sta_index  |   sta_index	|
  * |______________|_____________|_______________|
+ * @ampdu: per TID TX a-mpdu state and the load that decides when to start it.
+ * @rx_ba_tids: bitmap of TIDs with an RX block-ack session in firmware.
+ * @rx_ba_session: firmware BA session id per TID, valid while the TID is set
+ * in @rx_ba_tids.
+ * @tx_ba_session: firmware BA session id per TID, valid while the TID's
+ * @ampdu state is operational.
+ * @rx_ba_buf: firmware buffers held by the RX session of each TID.
+ * @tx_ba_buf: firmware buffers held by the TX session of each TID.
+ * @amsdu_node: entry in wcn->amsdu_list while frames are held for A-MSDU.
+ * @amsdu_q: per TID frames held for the next A-MSDU, under wcn->amsdu_lock.
+ * @stats: data path counters of frames to and from the station.
  */
 struct wcn36xx_sta {
 	struct wcn36xx_vif *vif;
 	u16 aid;
-	u16 tid;
 	u8 sta_index;
 	u8 dpu_desc_index;
 	u8 ucast_dpu_sign;
@@ -177,15 +372,49 @@ struct wcn36xx_sta {
 	/* Rates */
 	struct wcn36xx_hal_supported_rates supported_rates;
 
-	spinlock_t ampdu_lock;		/* protects next two fields */
-	enum wcn36xx_ampdu_state ampdu_state[16];
-	int non_agg_frame_ct;
+	struct wcn36xx_tid_ampdu ampdu[IEEE80211_NUM_TIDS];
+
+	spinlock_t ampdu_lock;		/* protects next five fields */
+	u16 rx_ba_tids;
+	u8 rx_ba_session[IEEE80211_NUM_TIDS];
+	u8 tx_ba_session[IEEE80211_NUM_TIDS];
+	u8 rx_ba_buf[IEEE80211_NUM_TIDS];
+	u8 tx_ba_buf[IEEE80211_NUM_TIDS];
+
+	struct list_head amsdu_node;
+	struct sk_buff_head amsdu_q[IEEE80211_NUM_TIDS];
+
+	struct wcn36xx_pcpu_stats __percpu *stats;
+};
+/**
+ * enum wcn36xx_start_phase - steps of the interface bring-up
+ *
+ * The DXE allocation runs in parallel with the firmware steps and
+ * @WCN36XX_START_DXE_WAIT is how long start blocked on it afterwards.
+ */
+enum wcn36xx_start_phase {
+	WCN36XX_START_SMD_OPEN,
+	WCN36XX_START_DXE_ALLOC,
+	WCN36XX_START_NV,
+	WCN36XX_START_FW,
+	WCN36XX_START_CAPS,
+	WCN36XX_START_DXE_WAIT,
+	WCN36XX_START_DXE_INIT,
+	WCN36XX_START_TOTAL,
+	WCN36XX_START_PHASE_NUM
 };
+
 struct wcn36xx_dxe_ch;
 struct wcn36xx {
 	struct ieee80211_hw	*hw;
 	struct device		*dev;
 	struct list_head	vif_list;
+	/*
+	 * Serializes changes to vif_list and to the association and BSS
+	 * state of its vifs against the scan worker. The RX path walks
+	 * vif_list under RCU instead.
+	 */
+	struct mutex		conf_mutex;
 
 	const struct firmware	*nv;
 
@@ -194,6 +423,12 @@ struct wcn36xx {
 	u8			fw_minor;
 	u8			fw_major;
 	u32			fw_feat_caps[WCN36XX_HAL_CAPS_SIZE];
+	/*
+	 * Firmware takes the new preferred network list format, valid once
+	 * pno_known is set by an update scan params response
+	 */
+	bool			pno_new_api;
+	bool			pno_known;
 	u32			chip_version;
 
 	/* extra byte for the NULL termination */
@@ -214,10 +449,22 @@ struct wcn36xx {
 	size_t			hal_rsp_len;
 	struct mutex		hal_mutex;
 	struct completion	hal_rsp_compl;
+	/* Protects hal_req_pending and the response copy into hal_buf */
+	spinlock_t		hal_rsp_lock;
+	bool			hal_req_pending;
+	enum wcn36xx_hal_host_msg_type hal_req_type;
 	struct workqueue_struct	*hal_ind_wq;
 	struct work_struct	hal_ind_work;
 	struct mutex		hal_ind_mutex;
 	struct list_head	hal_ind_queue;
+	/* Updated from the SMD callback and send path, see hal_stats_lock */
+	spinlock_t		hal_stats_lock;
+	struct wcn36xx_hal_msg_stats hal_stats[WCN36XX_HAL_MSG_NUM];
+
+	/* Bring-up timing of the last start in usecs */
+	u32			start_phase_us[WCN36XX_START_PHASE_NUM];
+	struct work_struct	dxe_alloc_work;
+	int			dxe_alloc_ret;
 
 	/* DXE channels */
 	struct wcn36xx_dxe_ch	dxe_tx_l_ch;	/* TX low */
@@ -235,6 +482,56 @@ struct wcn36xx {
 
 	struct sk_buff		*tx_ack_skb;
 
+	/* Scan, scan_lock protects scan_req and scan_aborted */
+	struct mutex		scan_lock;
+	struct workqueue_struct	*scan_wq;
+	struct work_struct	scan_work;
+	struct cfg80211_scan_request *scan_req;
+	struct ieee80211_vif	*scan_vif;
+	/* First channel of scan_req not yet handed to the scan offload */
+	int			scan_next;
+	bool			scan_aborted;
+	/* Channel the radio is scanning on, 0 when on the operating one */
+	int			scan_freq;
+	enum ieee80211_band	scan_band;
+	/* Background scan in progress, data frames seen at home */
+	bool			scan_bg;
+	atomic_t		scan_traffic;
+
+	/*
+	 * Stations with frames held for TX A-MSDU. The timer bounds how long
+	 * they are held, the tasklet sends them.
+	 */
+	spinlock_t		amsdu_lock;
+	struct list_head	amsdu_list;
+	struct hrtimer		amsdu_timer;
+	struct tasklet_struct	amsdu_tasklet;
+
+	/* Block-ack sessions open in firmware and the buffers they hold */
+	atomic_t		ba_sessions;
+	atomic_t		ba_buffers;
+
+	/* Pushes IPv6 NS offload changes from process context */
+	struct work_struct	ns_offload_work;
+
+	/*
+	 * Multicast list wanted by the stack, NULL when all multicast is
+	 * wanted. mc_lock also covers the per vif programmed copies.
+	 */
+	struct mutex		mc_lock;
+	struct wcn36xx_mc_list	*mc_list;
+
+	/*
+	 * Serializes GET_STATS and the per vif fw_stats, polled by
+	 * stats_work. Taken inside conf_mutex, which keeps vif_list stable.
+	 */
+	struct mutex		stats_lock;
+	struct delayed_work	stats_work;
+
+	/* RX packet filters indexed by filter id, see pkt_filter_lock */
+	struct mutex		pkt_filter_lock;
+	struct wcn36xx_pkt_filter pkt_filters[WCN36XX_HAL_MAX_NUM_FILTERS];
+
 #ifdef CONFIG_WCN36XX_DEBUGFS
 	/* Debug file system entry */
 	struct wcn36xx_dfs_entry    dfs;
@@ -257,6 +554,8 @@ static inline bool wcn36xx_is_fw_version(struct wcn36xx *wcn,
 		wcn->fw_revision == revision);
 }
 void wcn36xx_set_default_rates(struct wcn36xx_hal_supported_rates *rates);
+void wcn36xx_fw_stats_refresh(struct wcn36xx *wcn, unsigned int max_age_ms,
+			      bool poll);
 
 static inline
 struct wcn36xx_vif *wcn36xx_vif_to_priv(struct ieee80211_vif *vif)
@@ -282,4 +581,30 @@ struct ieee80211_sta *wcn36xx_priv_to_sta(struct wcn36xx_sta *sta_priv)
 	return container_of((void *) sta_priv, struct ieee80211_sta, drv_priv);
 }
 
+/* mac80211 access category of an 802.1d user priority */
+static inline u8 wcn36xx_up_to_ac(u8 up)
+{
+	static const u8 up_to_ac[8] = {
+		IEEE80211_AC_BE, IEEE80211_AC_BK,
+		IEEE80211_AC_BK, IEEE80211_AC_BE,
+		IEEE80211_AC_VI, IEEE80211_AC_VI,
+		IEEE80211_AC_VO, IEEE80211_AC_VO,
+	};
+
+	return up_to_ac[up & IEEE80211_QOS_CTL_TAG1D_MASK];
+}
+
+/* 802.11 ACI, as firmware numbers the ACs, of a mac80211 access category */
+static inline u8 wcn36xx_ac_to_aci(u16 ac)
+{
+	static const u8 ac_to_aci[IEEE80211_NUM_ACS] = {
+		[IEEE80211_AC_VO] = 3,
+		[IEEE80211_AC_VI] = 2,
+		[IEEE80211_AC_BE] = 0,
+		[IEEE80211_AC_BK] = 1,
+	};
+
+	return ac_to_aci[ac];
+}
+
 #endif	/* _WCN36XX_H_ */